@@ -9,7 +9,7 @@
 # - Transfer: Google drive?
 #
 
-QT += core gui bluetooth
+QT += core gui concurrent
 
 # android {
 #     QT += androidextras
@@ -45,51 +45,30 @@ message("Working directory is $$PWD")
 
 CONFIG += c++17
 
+include(db.pri)
+
 SOURCES += \
-    src/db/book.cpp \
-    src/db/pdfprint.cpp \
-    src/db/ingredientlistentries.cpp \
-    src/db/ingredientsmodel.cpp \
-    src/db/recipe.cpp \
-    src/db/recipedata.cpp \
-    src/db/recipesmodel.cpp \
-    src/db/unitsmodel.cpp \
     src/gui/gui_book.cpp \
     src/gui/gui_recipe.cpp \
     src/gui/filterview.cpp \
     src/gui/about.cpp \
     src/gui/planningview.cpp \
-    src/db/planningmodel.cpp \
-    src/db/settings.cpp \
     src/gui/gui_settings.cpp \
     src/gui/synchronizer.cpp \
     src/main.cpp
 
 HEADERS += \
-    src/db/book.h \
-    src/db/ingredientlistentries.h \
-    src/db/ingredientsmodel.h \
-    src/db/recipe.h \
-    src/db/recipedata.h \
-    src/db/recipesmodel.h \
-    src/db/unitsmodel.h \
     src/gui/androidspecifics.hpp \
     src/gui/autofiltercombobox.hpp \
     src/gui/gui_book.h \
     src/gui/gui_recipe.h \
     src/gui/filterview.h \
-    src/db/basemodel.hpp \
     src/gui/about.h \
     src/gui/about_metadata.h \
     src/gui/planningview.h \
-    src/db/planningmodel.h \
-    src/db/settings.h \
     src/gui/gui_settings.h \
     src/gui/synchronizer.h
 
-RESOURCES += \
-    resources.qrc
-
 DISTFILES += \
     android/AndroidManifest.xml \
     android/gradle.properties \
@@ -103,19 +82,25 @@ DISTFILES += \
 
 !android {
 SOURCES += \
+    src/gui/exportdialog.cpp \
     src/gui/ingredientsmanager.cpp \
     src/gui/listcontrols.cpp \
+    src/gui/mealplannerview.cpp \
     src/gui/repairsmanager.cpp \
+    src/gui/shoppinglistview.cpp \
     src/gui/updatemanager.cpp \
     src/gui/ingrediententrydialog.cpp \
     src/gui/common.cpp
 
 HEADERS += \
     src/gui/common.h \
+    src/gui/exportdialog.h \
     src/gui/ingrediententrydialog.h \
     src/gui/ingredientsmanager.h \
     src/gui/listcontrols.h \
+    src/gui/mealplannerview.h \
     src/gui/repairsmanager.h \
+    src/gui/shoppinglistview.h \
     src/gui/updatemanager.h
 }
 
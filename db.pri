@@ -0,0 +1,54 @@
+# Data layer, shared by the application and the command-line tool
+
+QT += core gui concurrent network
+CONFIG += c++17
+
+SOURCES += \
+    $$PWD/src/db/book.cpp \
+    $$PWD/src/db/expansion.cpp \
+    $$PWD/src/db/htmlexport.cpp \
+    $$PWD/src/db/httpserver.cpp \
+    $$PWD/src/db/ingredientlistentries.cpp \
+    $$PWD/src/db/ingredientsmodel.cpp \
+    $$PWD/src/db/mealplanner.cpp \
+    $$PWD/src/db/pantry.cpp \
+    $$PWD/src/db/pdfprint.cpp \
+    $$PWD/src/db/planninghistory.cpp \
+    $$PWD/src/db/planningmodel.cpp \
+    $$PWD/src/db/printjob.cpp \
+    $$PWD/src/db/query.cpp \
+    $$PWD/src/db/recipe.cpp \
+    $$PWD/src/db/recipedata.cpp \
+    $$PWD/src/db/recipegraph.cpp \
+    $$PWD/src/db/recipesmodel.cpp \
+    $$PWD/src/db/settings.cpp \
+    $$PWD/src/db/shoppinglist.cpp \
+    $$PWD/src/db/sync.cpp \
+    $$PWD/src/db/unitsmodel.cpp
+
+HEADERS += \
+    $$PWD/src/db/basemodel.hpp \
+    $$PWD/src/db/book.h \
+    $$PWD/src/db/expansion.h \
+    $$PWD/src/db/htmlexport.h \
+    $$PWD/src/db/httpserver.h \
+    $$PWD/src/db/ingredientlistentries.h \
+    $$PWD/src/db/ingredientsmodel.h \
+    $$PWD/src/db/mealplanner.h \
+    $$PWD/src/db/pantry.h \
+    $$PWD/src/db/pdfprint.h \
+    $$PWD/src/db/planninghistory.h \
+    $$PWD/src/db/planningmodel.h \
+    $$PWD/src/db/printjob.h \
+    $$PWD/src/db/query.h \
+    $$PWD/src/db/recipe.h \
+    $$PWD/src/db/recipedata.h \
+    $$PWD/src/db/recipegraph.h \
+    $$PWD/src/db/recipesmodel.h \
+    $$PWD/src/db/settings.h \
+    $$PWD/src/db/shoppinglist.h \
+    $$PWD/src/db/sync.h \
+    $$PWD/src/db/unitsmodel.h
+
+RESOURCES += \
+    $$PWD/resources.qrc
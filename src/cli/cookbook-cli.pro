@@ -0,0 +1,17 @@
+# Headless access to a cookbook (listing, queries, checks, exports)
+#  qmake src/cli && make
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = cookbook-cli
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+DEFINES += \
+    BASE_DIR=\\\"$$clean_path($$PWD/../..)\\\" BASE_BUILD_DIR=\\\"$$OUT_PWD\\\"
+
+include(../../db.pri)
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,369 @@
+#include <memory>
+#include <cstring>
+#include <vector>
+
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QLoggingCategory>
+#include <QTextStream>
+#include <QEventLoop>
+#include <QJsonDocument>
+#include <QCborValue>
+#include <QSaveFile>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+#include "../db/book.h"
+#include "../db/query.h"
+#include "../db/pdfprint.h"
+#include "../db/printjob.h"
+#include "../db/httpserver.h"
+#include "../db/sync.h"
+
+#include <QDebug>
+
+/// Headless access to a book: everything goes through the db layer, nothing
+/// is ever shown.
+///
+/// Exit codes: 0 on success, 1 when the command failed (or the check found
+/// problems), 2 on usage errors
+
+namespace {
+
+QTextStream& out (void) {
+  static QTextStream s (stdout);
+  return s;
+}
+
+QTextStream& err (void) {
+  static QTextStream s (stderr);
+  return s;
+}
+
+int usage (const QCommandLineParser &parser, const QString &message) {
+  err() << message << "\n\n" << parser.helpText();
+  return 2;
+}
+
+bool selection (const db::Book &book, const QString &query, db::IDSet &ids) {
+  db::QueryPlan plan;
+  QString error;
+  if (!plan.parse(query, &error)) {
+    err() << "Invalid query '" << query << "': " << error << "\n";
+    return false;
+  }
+  for (const db::Recipe *r: db::printOrder(book.recipes))
+    if (plan.accepts(*r)) ids.insert(r->id);
+  return true;
+}
+
+int info (const db::Book &book) {
+  int basic = 0;
+  for (const auto &p: book.recipes) basic += p.second.basic;
+  out() << "Recettes:    " << book.recipes.rowCount() << " (dont " << basic
+        << " de base)\n"
+        << "Ingrédients: " << book.ingredients.rowCount() << "\n"
+        << "Unités:      " << book.units.rowCount() << "\n";
+  return 0;
+}
+
+int list (const db::Book &book, const QStringList &args) {
+  db::IDSet ids;
+  bool filter = !args.isEmpty();
+  if (filter && !selection(book, args.join(' '), ids))  return 2;
+
+  for (const db::Recipe *r: db::printOrder(book.recipes, filter ? &ids : nullptr))
+    out() << int(r->id) << "\t" << r->title << "\n";
+  return 0;
+}
+
+/// Problems that the application either cannot create anymore or silently
+/// works around
+int check (const db::Book &book) {
+  int problems = 0;
+  const auto problem = [&problems] (const db::Recipe &r, const QString &what) {
+    err() << "[" << int(r.id) << "] " << r.title << ": " << what << "\n";
+    problems++;
+  };
+
+  const db::RecipeGraph &graph = book.recipes.graph();
+  std::map<QString, std::vector<const db::Recipe*>> titles;
+  for (const auto &p: book.recipes) {
+    const db::Recipe &r = p.second;
+    titles[db::normalized(r.title.simplified())].push_back(&r);
+
+    for (const auto &e: r.ingredients) {
+      if (e->etype == db::EntryType::Ingredient) {
+        if (!static_cast<const db::IngredientEntry&>(*e).valid())
+          problem(r, "ingrédient ou unité inconnu(e)");
+      } else if (e->etype == db::EntryType::SubRecipe) {
+        if (!static_cast<const db::SubRecipeEntry&>(*e).recipe)
+          problem(r, "sous-recette inconnue");
+      }
+    }
+
+    if (db::RecipeGraph::subrecipesOf(r.ingredients) != graph.subrecipes(r.id))
+      problem(r, "sous-recettes cycliques");
+  }
+
+  for (const auto &p: titles)
+    if (p.second.size() > 1)
+      for (const db::Recipe *r: p.second)  problem(*r, "titre en double");
+
+  std::map<QString, int> names;
+  int unused = 0;
+  for (const auto &p: book.ingredients) {
+    const db::IngredientData &d = p.second;
+    if (++names[db::normalized(d.text.simplified())] == 2) {
+      err() << "Ingrédient en double: " << d.text << "\n";
+      problems++;
+    }
+    unused += (d.used == 0);
+  }
+  if (unused > 0)
+    out() << unused << " ingrédient(s) inutilisé(s)\n";
+
+  out() << problems << " problème(s)\n";
+  return problems > 0;
+}
+
+int exportBook (const db::Book &book, const QStringList &args) {
+  static const QMap<QString, db::PrintSnapshot::Format> formats {
+    {   "pdf", db::PrintSnapshot::PDF   },
+    { "latex", db::PrintSnapshot::LATEX },
+    {  "html", db::PrintSnapshot::HTML  },
+  };
+  if (args.size() < 2 || !formats.contains(args[0]))  return -1;
+
+  db::IDSet ids;
+  bool filter = args.size() > 2;
+  if (filter && !selection(book, args.mid(2).join(' '), ids))  return 2;
+
+  db::PrintJob job (book, formats.value(args[0]), args[1],
+                    filter ? &ids : nullptr);
+  QObject::connect(&job, &db::PrintJob::progress, [] (int done, int total) {
+    err() << "\r" << done << "/" << total << Qt::flush;
+  });
+
+  bool ok = false, done = false;
+  QEventLoop loop;
+  QObject::connect(&job, &db::PrintJob::finished, [&] (bool success) {
+    ok = success;
+    done = true;
+    loop.quit();
+  });
+  job.start();
+  if (!done)  loop.exec();
+
+  err() << "\n";
+  if (!ok)  err() << "Échec de l'export vers " << args[1] << "\n";
+  return !ok;
+}
+
+int convert (const db::Book &book, const QStringList &args, bool compact) {
+  if (args.size() != 1) return -1;
+
+  const QString &path = args[0];
+  QJsonObject json = book.toJson();
+  QByteArray data;
+  if (path.endsWith(".cbor"))
+    data = QCborValue::fromJsonValue(json).toCbor();
+  else
+    data = QJsonDocument(json).toJson(compact ? QJsonDocument::Compact
+                                              : QJsonDocument::Indented);
+
+  // Never leaves a truncated book behind, sync writes it in place
+  QSaveFile file (path);
+  if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size()
+      || !file.commit()) {
+    err() << "Impossible d'écrire " << path << "\n";
+    return 1;
+  }
+  return 0;
+}
+
+/// Optional port argument at index i
+bool port (const QStringList &args, int i, quint16 &value) {
+  if (args.size() <= i) return true;
+  bool ok = false;
+  int p = args[i].toInt(&ok);
+  if (!ok || p < 0 || 65535 < p)  return false;
+  value = quint16(p);
+  return true;
+}
+
+/// Until interrupted
+int serve (db::Book &book, const QStringList &args) {
+  quint16 p = 8080;
+  if (args.size() > 1 || !port(args, 0, p)) return -1;
+
+  db::HttpServer server (book);
+  if (!server.listen(p)) {
+    err() << "Impossible d'écouter sur le port " << p << ": "
+          << server.errorString() << "\n";
+    return 1;
+  }
+  err() << "http://localhost:" << server.port() << "/" << Qt::endl;
+  return QCoreApplication::exec();
+}
+
+/// Mirrors the server's book into the local one (saved in place)
+int synchronize (db::Book &book, const QStringList &args, const QString &path) {
+  quint16 p = db::SyncSession::DefaultPort;
+  if (args.isEmpty() || args.size() > 2 || !port(args, 1, p)) return -1;
+
+  QTcpSocket socket;
+  socket.connectToHost(args[0], p);
+  if (!socket.waitForConnected(5000)) {
+    err() << "Connexion à " << args[0] << ":" << p << " impossible: "
+          << socket.errorString() << "\n";
+    return 1;
+  }
+
+  bool ok = false;
+  QEventLoop loop;
+  db::SyncSession session (book, db::SyncSession::CLIENT, &socket);
+  QObject::connect(&session, &db::SyncSession::finished,
+                   [&] (bool success, const QString &message) {
+    ok = success;
+    err() << message << "\n";
+    loop.quit();
+  });
+  session.start();
+  if (!session.isFinished())  loop.exec();
+  socket.disconnectFromHost();
+  if (socket.state() != QAbstractSocket::UnconnectedState)
+    socket.waitForDisconnected(1000);
+
+  const db::SyncSession::Stats &s = session.stats();
+  out() << s.updated << " mis à jour, " << s.removed << " supprimé(s), "
+        << s.sent << " octets envoyés, " << s.received << " reçus\n";
+  if (!ok)  return 1;
+  if (s.updated + s.removed == 0) return 0;
+  return convert(book, {path}, false);
+}
+
+/// Until interrupted
+int syncServer (db::Book &book, const QStringList &args) {
+  quint16 p = db::SyncSession::DefaultPort;
+  if (args.size() > 1 || !port(args, 0, p)) return -1;
+
+  QTcpServer server;
+  if (!server.listen(QHostAddress::Any, p)) {
+    err() << "Impossible d'écouter sur le port " << p << ": "
+          << server.errorString() << "\n";
+    return 1;
+  }
+  err() << "En attente sur le port " << server.serverPort() << Qt::endl;
+
+  QObject::connect(&server, &QTcpServer::newConnection, [&] {
+    while (QTcpSocket *socket = server.nextPendingConnection()) {
+      auto session = new db::SyncSession(book, db::SyncSession::SERVER, socket,
+                                         socket);
+      QObject::connect(session, &db::SyncSession::finished,
+                       [socket] (bool, const QString &message) {
+        err() << socket->peerAddress().toString() << ": " << message
+              << Qt::endl;
+        socket->disconnectFromHost();
+        socket->deleteLater();
+      });
+      session->start();
+    }
+  });
+  return QCoreApplication::exec();
+}
+
+/// Whether the command is 'export pdf', before the parser can tell. Only
+/// --book/-b take a value (see main)
+bool exportsPdf (int argc, char *argv[]) {
+  std::vector<const char*> positional;
+  for (int i=1; i<argc && positional.size() < 2; i++) {
+    const char *a = argv[i];
+    if (std::strcmp(a, "--") == 0) {
+      for (i++; i<argc && positional.size() < 2; i++)
+        positional.push_back(argv[i]);
+    } else if (std::strcmp(a, "-b") == 0 || std::strcmp(a, "--book") == 0)
+      i++;
+    else if (a[0] != '-')
+      positional.push_back(a);
+  }
+  return positional.size() == 2 && std::strcmp(positional[0], "export") == 0
+      && std::strcmp(positional[1], "pdf") == 0;
+}
+
+} // end of anonymous namespace
+
+int main(int argc, char *argv[]) {
+  // Only the native pdf renderer (fonts, layout) needs a gui application
+  bool gui = exportsPdf(argc, argv);
+
+  std::unique_ptr<QCoreApplication> app;
+  if (gui) {
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+      qputenv("QT_QPA_PLATFORM", "offscreen");
+    app.reset(new QGuiApplication (argc, argv));
+  } else
+    app.reset(new QCoreApplication (argc, argv));
+
+  QCoreApplication::setOrganizationName("almann");
+  QCoreApplication::setApplicationName("cookbook");
+  QCoreApplication::setApplicationVersion("1.1.0");
+  QLocale::setDefault(QLocale::c());
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription(
+    "Accès en ligne de commande à un livre de recettes.\n\n"
+    "Commandes:\n"
+    "  info                            Statistiques\n"
+    "  list [requête]                  Recettes (filtrées)\n"
+    "  check                           Vérification de l'intégrité\n"
+    "  export <pdf|latex|html> <sortie> [requête]\n"
+    "                                  Export (d'une sélection)\n"
+    "  convert <sortie.rbk|.json|.cbor>\n"
+    "                                  Conversion de format\n"
+    "  serve [port]                    Accès en lecture par http (json)\n"
+    "  sync <hôte> [port]              Copie (incrémentale) d'un livre distant\n"
+    "  sync-server [port]              Partage du livre pour sync");
+  parser.addHelpOption();
+  parser.addVersionOption();
+
+  QCommandLineOption bookOption ({"b", "book"}, "Livre à ouvrir", "fichier",
+                                 db::Book::monitoredPath());
+  QCommandLineOption verboseOption ({"v", "verbose"}, "Messages de débogage");
+  QCommandLineOption compactOption ("compact", "Json sans indentation");
+  parser.addOptions({ bookOption, verboseOption, compactOption });
+  parser.addPositionalArgument("commande",
+                               "info, list, check, export, convert, serve, sync, "
+                               "sync-server");
+  parser.process(*app);
+
+  if (!parser.isSet(verboseOption))
+    QLoggingCategory::setFilterRules("*.debug=false\n*.info=false");
+
+  QStringList args = parser.positionalArguments();
+  if (args.isEmpty()) return usage(parser, "Commande manquante");
+  QString command = args.takeFirst();
+
+  db::Book &book = db::Book::current();
+  if (!book.load(parser.value(bookOption))) {
+    err() << "Impossible de charger " << parser.value(bookOption) << "\n";
+    return 1;
+  }
+
+  int code = -1;
+  if (command == "info")          code = info(book);
+  else if (command == "list")     code = list(book, args);
+  else if (command == "check")    code = check(book);
+  else if (command == "export")   code = exportBook(book, args);
+  else if (command == "convert")
+    code = convert(book, args, parser.isSet(compactOption));
+  else if (command == "serve")    code = serve(book, args);
+  else if (command == "sync")
+    code = synchronize(book, args, parser.value(bookOption));
+  else if (command == "sync-server")  code = syncServer(book, args);
+  else
+    return usage(parser, "Commande inconnue: " + command);
+
+  if (code < 0) return usage(parser, "Arguments invalides pour " + command);
+  return code;
+}
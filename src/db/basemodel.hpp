@@ -2,6 +2,7 @@
 #define BASEMODEL_H
 
 #include <sstream>
+#include <vector>
 
 #include <QAbstractTableModel>
 
@@ -65,6 +66,18 @@ struct BaseModel : public QAbstractTableModel {
     endResetModel();
   }
 
+  /// Adds these values, or replaces them in place (references remain valid),
+  /// keeping their ids. E.g. to mirror another book
+  void merge (const std::vector<T> &values) {
+    if (values.empty()) return;
+    beginResetModel();
+    for (const T &v: values) {
+      _data.insert_or_assign(v.id, v);
+      if (_nextID <= v.id)  _nextID = ID(int(v.id)+1);
+    }
+    endResetModel();
+  }
+
   virtual void valueModified (ID id) = 0;
 
 // =============================================================================
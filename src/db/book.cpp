@@ -1,7 +1,8 @@
+#include <set>
+
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QJsonDocument>
-#include <QMessageBox>
 
 #include <QFile>
 
@@ -13,11 +14,126 @@
 
 namespace db {
 
-Book::Book(void) : _modified(false) {
+namespace {
+
+using IDs = std::set<ID>;
+
+bool fail (QString *error, const QString &what) {
+  if (error)  *error = what;
+  return false;
+}
+
+bool isID (const QJsonValue &v) {
+  return v.isDouble() && v.toInt() > 0;
+}
+
+template <typename T>
+bool isStatic (const QJsonValue &v) {
+  return isID(v) && v.toInt() <= int(T::database().size());
+}
+
+/// Ingredient list of a recipe, as saved
+bool validEntries (const QJsonArray &entries, const IDs &units,
+                   const IDs &ingredients, const IDs &recipes) {
+  for (const QJsonValue &v: entries) {
+    const QJsonArray e = v.toArray();
+    if (e.size() != 2)  return false;
+    switch (e[0].toInt(-1)) {
+    case int(EntryType::Ingredient): {
+      const QJsonArray i = e[1].toArray();
+      if (i.size() != 4 || !units.count(ID(i[1].toInt()))
+          || !ingredients.count(ID(i[2].toInt())))
+        return false;
+      break;
+    }
+    case int(EntryType::SubRecipe):
+      if (!recipes.count(ID(e[1].toInt()))) return false;
+      break;
+    case int(EntryType::Decoration):
+      break;
+    default:
+      return false;
+    }
+  }
+  return true;
+}
+
+/// A planning day, as saved
+bool validDay (const QJsonValue &v, const IDs &recipes) {
+  const QJsonArray d = v.toArray();
+  if (d.size() != PlanningModel::ROWS+1
+      || !QDate::fromString(d[0].toString(), Qt::ISODate).isValid())
+    return false;
+  for (int i=1; i<d.size(); i++) {
+    if (!d[i].isArray())  return false;
+    for (const QJsonValue &item: d[i].toArray())
+      if (item.isDouble() ? !recipes.count(ID(item.toInt())) : !item.isString())
+        return false;
+  }
+  return true;
+}
+
+} // end of anonymous namespace
+
+Book::Book(void)
+  : pantry(recipes), expansion(recipes),
+    shopping(planning, recipes, expansion), _modified(false) {
   for (QAbstractTableModel *m: std::initializer_list<QAbstractTableModel*>{
                                   &recipes, &ingredients, &units, &planning})
     connect(m, &QAbstractItemModel::dataChanged,
             this, QOverload<>::of(&Book::setModified));
+  // Past days archived into the history (trailing empty ones are not saved)
+  connect(&planning, &QAbstractItemModel::columnsRemoved, this,
+          [this] (const QModelIndex &, int first) {
+    if (first == 0) setModified(true);
+  });
+
+  const auto invalidatePantry = [this] { pantry.invalidate(); };
+  for (QAbstractTableModel *m: std::initializer_list<QAbstractTableModel*>{
+                                  &recipes, &ingredients}) {
+    connect(m, &QAbstractItemModel::dataChanged, this, invalidatePantry);
+    connect(m, &QAbstractItemModel::rowsInserted, this, invalidatePantry);
+    connect(m, &QAbstractItemModel::rowsRemoved, this, invalidatePantry);
+    connect(m, &QAbstractItemModel::modelReset, this, invalidatePantry);
+  }
+
+  connect(&recipes, &QAbstractItemModel::dataChanged, this,
+          [this] (const QModelIndex &topLeft, const QModelIndex &bottomRight) {
+    for (int r = topLeft.row(); r <= bottomRight.row(); r++) {
+      ID id = ID(recipes.index(r, 0).data(IDRole).toInt());
+      expansion.invalidate(id);
+      planning.recipeModified(id);
+    }
+  });
+  // Ids of deleted recipes get reused
+  connect(&recipes, &QAbstractItemModel::rowsAboutToBeRemoved, this,
+          [this] (const QModelIndex &, int first, int last) {
+    for (int r = first; r <= last; r++)
+      history.remove(ID(recipes.index(r, 0).data(IDRole).toInt()));
+  });
+
+  const auto clearExpansion = [this] { expansion.clear(); };
+  connect(&recipes, &QAbstractItemModel::modelReset, this, clearExpansion);
+  for (QAbstractTableModel *m: std::initializer_list<QAbstractTableModel*>{
+                                  &ingredients, &units}) {
+    connect(m, &QAbstractItemModel::rowsRemoved, this, clearExpansion);
+    connect(m, &QAbstractItemModel::modelReset, this, clearExpansion);
+  }
+  connect(&units, &QAbstractItemModel::dataChanged, this, clearExpansion);
+  connect(&units, &QAbstractItemModel::rowsInserted, this, clearExpansion);
+
+  const auto clearSummaries = [this] { recipes.clearSummaries(); };
+  for (QAbstractTableModel *m: std::initializer_list<QAbstractTableModel*>{
+                                  &ingredients, &units}) {
+    connect(m, &QAbstractItemModel::dataChanged, this, clearSummaries);
+    connect(m, &QAbstractItemModel::rowsRemoved, this, clearSummaries);
+    connect(m, &QAbstractItemModel::modelReset, this, clearSummaries);
+  }
+
+  // Once the expansion cache is up to date
+  const auto invalidateShopping = [this] { shopping.invalidate(); };
+  connect(&recipes, &QAbstractItemModel::dataChanged, this, invalidateShopping);
+  connect(&recipes, &QAbstractItemModel::modelReset, this, invalidateShopping);
 }
 
 void Book::setModified(bool m) {
@@ -34,28 +150,6 @@ QModelIndex Book::addRecipe(Recipe &&r) {
   return recipes.addRecipe(std::move(r));
 }
 
-bool Book::close (QWidget *widget) {
-#ifndef Q_OS_ANDROID
-  if (!_modified) return true;
-  auto ret = QMessageBox::warning(widget, "Confirmez",
-                                  "Sauvegarder les changements?",
-                                  QMessageBox::Yes | QMessageBox::No | QMessageBox::Cancel);
-  switch (ret) {
-  case QMessageBox::Yes:
-    autosave(false);
-    return true;
-  case QMessageBox::No:
-    return true;
-  case QMessageBox::Cancel:
-  default:
-    return false;
-  }
-#else
-  (void)widget;
-  return true;
-#endif
-}
-
 #ifndef Q_OS_ANDROID
 bool Book::autosave(bool spontaneous) {
   // Nothing to save
@@ -63,13 +157,143 @@ bool Book::autosave(bool spontaneous) {
   if (spontaneous && !Settings::value<bool>(Settings::AUTOSAVE))  return false;
   return save();
 }
+#endif
 
-bool Book::save(void) {
+QJsonObject Book::toJson(void) const {
   QJsonObject json;
   json["planning"] = planning.toJson();
+  json["history"] = history.toJson();
   json["recipes"] = recipes.toJson();
   json["ingredients"] = ingredients.toJson();
   json["units"] = units.toJson();
+  return json;
+}
+
+bool Book::mergeable(const QJsonObject &updated, const QJsonObject &removed,
+                     QString *error) const {
+  // Identifiers once merged
+  IDs u, i, r;
+  for (const auto &p: units)  u.insert(p.first);
+  for (const auto &p: ingredients)  i.insert(p.first);
+  for (const auto &p: recipes)  r.insert(p.first);
+
+  const auto remove = [error] (IDs &ids, const QJsonValue &v,
+                               const QString &what) {
+    for (const QJsonValue &id: v.toArray())
+      if (!ids.erase(ID(id.toInt())))
+        return fail(error, what + " à supprimer inconnu(e)");
+    return true;
+  };
+  if (!remove(u, removed["units"], "Unité")
+      || !remove(i, removed["ingredients"], "Ingrédient")
+      || !remove(r, removed["recipes"], "Recette"))
+    return false;
+
+  for (const QJsonValue &v: updated["units"].toArray()) {
+    const QJsonArray a = v.toArray();
+    if (a.size() != 3 || !isID(a[0]) || !a[1].isString())
+      return fail(error, "Unité invalide");
+    u.insert(ID(a[0].toInt()));
+  }
+
+  for (const QJsonValue &v: updated["ingredients"].toArray()) {
+    const QJsonArray a = v.toArray();
+    if (a.size() != 4 || !isID(a[0]) || !a[1].isString()
+        || !isStatic<AlimentaryGroupData>(a[2]))
+      return fail(error, "Ingrédient invalide");
+    i.insert(ID(a[0].toInt()));
+  }
+
+  IDs changed;
+  for (const QJsonValue &v: updated["recipes"].toArray()) {
+    const QJsonObject o = v.toObject();
+    if (!isID(o["id"]) || !isStatic<RegimenData>(o["regimen"])
+        || !isStatic<StatusData>(o["status"])
+        || !isStatic<DishTypeData>(o["type"])
+        || !isStatic<DurationData>(o["duration"]) || !o["ing"].isArray())
+      return fail(error, "Recette invalide");
+    r.insert(ID(o["id"].toInt()));
+    changed.insert(ID(o["id"].toInt()));
+  }
+
+  // Every recipe (new or kept) only refers to what remains
+  for (const QJsonValue &v: updated["recipes"].toArray()) {
+    const QJsonObject o = v.toObject();
+    if (!validEntries(o["ing"].toArray(), u, i, r))
+      return fail(error, "Recette incohérente: " + o["title"].toString());
+  }
+  for (const auto &p: recipes) {
+    if (!r.count(p.first) || changed.count(p.first))  continue;
+    const QJsonObject o = Recipe::toJson(p.second).toObject();
+    if (!validEntries(o["ing"].toArray(), u, i, r))
+      return fail(error, "Recette incohérente: " + p.second.title);
+  }
+
+  // Same for the planning
+  std::set<QDate> days;
+  for (const QJsonValue &v: removed["planning"].toArray()) {
+    QDate d = QDate::fromString(v.toString(), Qt::ISODate);
+    if (!d.isValid()) return fail(error, "Jour invalide");
+    days.insert(d);
+  }
+  for (const QJsonValue &v: updated["planning"].toArray()) {
+    if (!validDay(v, r))  return fail(error, "Jour invalide");
+    days.insert(QDate::fromString(v.toArray()[0].toString(), Qt::ISODate));
+  }
+  for (const QJsonValue &v: planning.toJson())
+    if (!days.count(QDate::fromString(v.toArray()[0].toString(), Qt::ISODate))
+        && !validDay(v, r))
+      return fail(error, "Jour incohérent: " + v.toArray()[0].toString());
+
+  if (updated.contains("history") && !updated["history"].isObject())
+    return fail(error, "Historique invalide");
+
+  return true;
+}
+
+bool Book::merge(const QJsonObject &updated, const QJsonObject &removed,
+                 QString *error) {
+  if (!mergeable(updated, removed, error))  return false;
+
+  std::vector<UnitData> u;
+  for (const QJsonValue &v: updated["units"].toArray())
+    u.push_back(UnitData::fromJson(v.toArray()));
+  units.merge(u);
+
+  std::vector<IngredientData> i;
+  for (const QJsonValue &v: updated["ingredients"].toArray())
+    i.push_back(IngredientData::fromJson(v.toArray()));
+  ingredients.merge(i);
+
+  recipes.merge(updated["recipes"].toArray());
+
+  // Before removing recipes: the planning refers to them
+  std::vector<QDate> days;
+  for (const QJsonValue &v: removed["planning"].toArray())
+    days.push_back(QDate::fromString(v.toString(), Qt::ISODate));
+  if (updated.contains("planning") || !days.empty())
+    planning.merge(updated["planning"].toArray(), days);
+
+  for (const QJsonValue &v: removed["recipes"].toArray())
+    recipes.delRecipe(&recipes.at(ID(v.toInt())));
+
+  // After removing recipes, which purges them from the local history
+  if (updated.contains("history"))
+    history.fromJson(updated["history"].toObject());
+
+  for (const QJsonValue &v: removed["ingredients"].toArray())
+    ingredients.removeItem(ID(v.toInt()));
+  for (const QJsonValue &v: removed["units"].toArray())
+    units.removeItem(ID(v.toInt()));
+
+  pantry.invalidate();
+  expansion.clear();
+  setModified(true);
+  return true;
+}
+
+bool Book::save(void) {
+  QJsonObject json = toJson();
 
   int eindex = monitoredPath().lastIndexOf('.');
   QString backup = monitoredPath().mid(0, eindex);
@@ -96,13 +320,16 @@ bool Book::save(void) {
   setModified(false);
   return true;
 }
-#endif
 
 bool Book::load (void) {
-  QFile loadFile (monitoredPath());
+  return load(monitoredPath());
+}
+
+bool Book::load (const QString &path) {
+  QFile loadFile (path);
 
   if (!loadFile.open(QIODevice::ReadOnly)) {
-    qWarning("Failed to open file '%s'", monitoredPath().toStdString().c_str());
+    qWarning("Failed to open file '%s'", path.toStdString().c_str());
     return false;
   }
 
@@ -112,7 +339,7 @@ bool Book::load (void) {
 
   if (json_doc.isNull()) {
     qWarning("Failed to parse json file '%s': %s",
-             monitoredPath().toStdString().c_str(),
+             path.toStdString().c_str(),
              err.errorString().toStdString().c_str());
     return false;
   }
@@ -122,10 +349,12 @@ bool Book::load (void) {
   ingredients.fromJson(json["ingredients"].toArray());
   recipes.fromJson(json["recipes"].toArray());
   planning.fromJson(json["planning"].toArray());
+  history.fromJson(json["history"].toObject());
+  pantry.invalidate();
+  expansion.clear();
 
 
-  qInfo("Loaded and parsed database from '%s'",
-        monitoredPath().toStdString().c_str());
+  qInfo("Loaded and parsed database from '%s'", path.toStdString().c_str());
 
   setModified(false);
   return true;
@@ -7,6 +7,10 @@
 #include "ingredientsmodel.h"
 #include "unitsmodel.h"
 #include "planningmodel.h"
+#include "planninghistory.h"
+#include "pantry.h"
+#include "expansion.h"
+#include "shoppinglist.h"
 
 namespace db {
 
@@ -18,19 +22,34 @@ public:
   UnitsModel units;
 
   PlanningModel planning;
+  PlanningHistory history;
+
+  Pantry pantry;
+  Expansion expansion;
+  ShoppingList shopping;
 
   Book(void);
 
   QModelIndex addRecipe (Recipe &&r);
 
   bool load (void);
+  bool load (const QString &path);
+  QJsonObject toJson (void) const;
+
+  /// Mirrors some of another book's records. Both objects are laid out as in
+  /// toJson: updated holds whole records (the history as a single object),
+  /// removed the ids of the units, ingredients and recipes and the (iso)
+  /// dates of the planning days to delete. Nothing changes (and false is
+  /// returned) if the records are malformed or would refer to missing ones
+  bool merge (const QJsonObject &updated, const QJsonObject &removed,
+              QString *error = nullptr);
+
+  bool save (void);
 #ifndef Q_OS_ANDROID
   bool autosave (bool spontaneous);
-  bool save (void);
   bool print(void);
+  bool printLatex(void);
 #endif
-  bool close (QWidget *widget = nullptr);
-
   bool isModified (void) {
     return _modified;
   }
@@ -48,6 +67,9 @@ signals:
 private:
   bool _modified;
 
+  bool mergeable (const QJsonObject &updated, const QJsonObject &removed,
+                  QString *error) const;
+
   void setModified (bool m);
   void setModified (void) {
     setModified(true);
@@ -0,0 +1,62 @@
+#include <algorithm>
+
+#include "expansion.h"
+#include "book.h"
+
+#include <QDebug>
+
+namespace db {
+
+const Expansion::Quantities& Expansion::of(const Recipe &r) {
+  auto it = _cache.find(r.id);
+  if (it != _cache.end()) return it->second;
+
+  // Convertible units are summed in their dimension's reference unit
+  const UnitsModel &units = Book::current().units;
+  Quantities q;
+  for (const auto &e: r.ingredients) {
+    if (e->etype != EntryType::Ingredient)  continue;
+    const auto &i = static_cast<const IngredientEntry&>(*e);
+    const UnitData &u = units.reference(*i.unit);
+    q[{i.idata->id, u.id}] += i.amount * i.unit->factor / u.factor;
+  }
+
+  // Subrecipes are used with the same ratio as their parent. The graph is
+  // acyclic so this recursion terminates
+  for (ID sub: _recipes.graph().subrecipes(r.id))
+    for (const auto &p: of(_recipes.at(sub)))
+      q[p.first] += p.second;
+
+  return _cache[r.id] = std::move(q);
+}
+
+Expansion::Quantities Expansion::of(const Recipe &r, double ratio) {
+  Quantities q = of(r);
+  for (auto &p: q)  p.second *= ratio;
+  return q;
+}
+
+QStringList Expansion::format(const Quantities &q, double ratio) const {
+  auto &book = Book::current();
+  std::vector<IngredientEntry> entries;
+  for (const auto &p: q)
+    entries.push_back(IngredientEntry(p.second, &book.units.at(p.first.second),
+                                   &book.ingredients.at(p.first.first), ""));
+  std::sort(entries.begin(), entries.end(),
+            [] (const IngredientEntry &lhs, const IngredientEntry &rhs) {
+    return QString::localeAwareCompare(lhs.type(), rhs.type()) < 0;
+  });
+
+  QStringList l;
+  for (const IngredientEntry &e: entries)
+    l.append(e.data(Qt::DisplayRole, ratio).toString());
+  return l;
+}
+
+void Expansion::invalidate(ID recipe) {
+  if (_cache.empty()) return;
+  _cache.erase(recipe);
+  for (ID a: _recipes.graph().ancestors(recipe))  _cache.erase(a);
+}
+
+} // end of namespace db
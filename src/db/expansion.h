@@ -0,0 +1,41 @@
+#ifndef DB_EXPANSION_H
+#define DB_EXPANSION_H
+
+#include "recipesmodel.h"
+
+namespace db {
+
+/// Complete ingredient list of a recipe, every subrecipe level expanded and
+/// quantities summed by (ingredient, unit), converting between units of the
+/// same dimension. Results are memoised for one
+/// batch of the recipe and only the edited recipe and its users (as per the
+/// subrecipe graph) are forgotten on modification.
+class Expansion {
+public:
+  using Key = std::pair<ID, ID>;  // ingredient, unit
+  using Quantities = std::map<Key, double>;
+
+  Expansion (const RecipesModel &recipes) : _recipes(recipes) {}
+
+  /// Quantities for the recipe's own number of portions
+  const Quantities& of (const Recipe &r);
+
+  /// Quantities for ratio times the recipe's own number of portions
+  Quantities of (const Recipe &r, double ratio);
+
+  /// Human readable lines (e.g. "200 g de farine"), sorted by ingredient
+  QStringList format (const Quantities &q, double ratio = 1) const;
+
+  void invalidate (ID recipe);
+  void clear (void) {
+    _cache.clear();
+  }
+
+private:
+  const RecipesModel &_recipes;
+  std::map<ID, Quantities> _cache;
+};
+
+} // end of namespace db
+
+#endif // DB_EXPANSION_H
@@ -0,0 +1,250 @@
+#include <QDir>
+#include <QFile>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QCryptographicHash>
+#include <QRegularExpression>
+#include <QtConcurrent>
+
+#include "htmlexport.h"
+#include "book.h"
+#include "query.h"
+
+#include <QDebug>
+
+#ifndef Q_OS_ANDROID
+
+namespace db {
+
+namespace {
+
+const char *manifestFile = ".manifest.json";
+
+const char *style = R"(body {
+  font-family: sans-serif;
+  max-width: 50em;
+  margin: auto;
+  padding: 0 1em;
+}
+nav a { margin-right: 1em; }
+table { border-collapse: collapse; width: 100%; }
+th, td { border: 1px solid #ccc; padding: .3em; vertical-align: top; }
+#search { width: 100%; font-size: 1.2em; }
+)";
+
+const char *script = R"((function () {
+  var input = document.getElementById('search');
+  var results = document.getElementById('results');
+  var recipes = document.getElementById('recipes');
+
+  function normalize (s) {
+    return s.normalize('NFD').replace(/[\u0300-\u036f]/g, '').toLowerCase();
+  }
+
+  function matches (word) {
+    var found = {};
+    for (var term in searchIndex.terms)
+      if (term.indexOf(word) === 0)
+        searchIndex.terms[term].forEach(function (i) { found[i] = true; });
+    return found;
+  }
+
+  input.addEventListener('input', function () {
+    var words = normalize(input.value).split(/[^a-z0-9]+/)
+                  .filter(function (w) { return w.length > 0; });
+    results.innerHTML = '';
+    recipes.hidden = words.length > 0;
+    if (words.length === 0) return;
+
+    var found = null;
+    words.forEach(function (w) {
+      var m = matches(w);
+      if (found === null) found = m;
+      else for (var i in found) if (!m[i]) delete found[i];
+    });
+
+    Object.keys(found).map(Number).sort(function (a, b) { return a - b; })
+      .forEach(function (i) {
+        var li = document.createElement('li');
+        var a = document.createElement('a');
+        a.href = searchIndex.recipes[i].u;
+        a.textContent = searchIndex.recipes[i].t;
+        li.appendChild(a);
+        results.appendChild(li);
+      });
+  });
+})();
+)";
+
+QString page (const QString &title, const QString &body, const QString &root) {
+  return QString(
+    "<!DOCTYPE html>\n<html lang=\"fr\">\n<head>\n"
+    "<meta charset=\"utf-8\">\n"
+    "<meta name=\"viewport\" content=\"width=device-width, initial-scale=1\">\n"
+    "<title>%1</title>\n"
+    "<link rel=\"stylesheet\" href=\"%2style.css\">\n"
+    "</head>\n<body>\n"
+    "<nav><a href=\"%2index.html\">Recettes</a>"
+    "<a href=\"%2planning.html\">Planning</a></nav>\n"
+    "%3</body>\n</html>\n").arg(title.toHtmlEscaped(), root, body);
+}
+
+/// Words of a text, as looked for by search.js
+QStringList terms (const QString &text) {
+  static const QRegularExpression separators ("[^a-z0-9]+");
+  QStringList words;
+  for (const QString &w: normalized(text).split(separators, Qt::SkipEmptyParts))
+    if (w.size() > 1) words.append(w);
+  return words;
+}
+
+QJsonObject searchIndex (const PrintSnapshot &snapshot) {
+  QJsonArray recipes;
+  std::map<QString, std::set<int>> index;
+  for (uint i=0; i<snapshot.entries.size(); i++) {
+    const auto &e = snapshot.entries[i];
+    recipes.append(QJsonObject {
+      { "t", e.title }, { "u", QString("recipes/%1.html").arg(e.id) }
+    });
+    for (const QString &k: e.keywords)
+      for (const QString &t: terms(k))
+        index[t].insert(int(i));
+  }
+
+  QJsonObject jterms;
+  for (const auto &p: index) {
+    QJsonArray ids;
+    for (int i: p.second) ids.append(i);
+    jterms[p.first] = ids;
+  }
+
+  return QJsonObject { { "recipes", recipes }, { "terms", jterms } };
+}
+
+/// Hash of each file written by the last export
+using Manifest = std::map<QString, QString>;
+
+struct File {
+  QString path;     // relative to the site's root
+  QByteArray contents;
+  QString hash;
+};
+
+bool write (const QDir &dir, const Manifest &manifest, File &f) {
+  f.hash = QCryptographicHash::hash(f.contents, QCryptographicHash::Sha1)
+            .toHex();
+  auto it = manifest.find(f.path);
+  if (it != manifest.end() && it->second == f.hash && dir.exists(f.path))
+    return true;
+
+  QFile file (dir.filePath(f.path));
+  if (!file.open(QIODevice::WriteOnly)) {
+    qWarning() << "Could not write to" << file.fileName();
+    return false;
+  }
+  file.write(f.contents);
+  return true;
+}
+
+} // end of anonymous namespace
+
+QString siteOutput (void) {
+  return Book::monitoredDir() + "/site";
+}
+
+bool exportHtml (const PrintSnapshot &snapshot, const QString &path,
+                 const std::atomic_bool &cancelled,
+                 const PrintProgress &progress) {
+  Q_ASSERT(snapshot.format == PrintSnapshot::HTML);
+
+  QDir dir (path);
+  if (!dir.mkpath("recipes")) {
+    qWarning() << "Could not create" << dir.filePath("recipes");
+    return false;
+  }
+
+  Manifest manifest;
+  {
+    QFile f (dir.filePath(manifestFile));
+    if (f.open(QIODevice::ReadOnly)) {
+      QJsonObject j = QJsonDocument::fromJson(f.readAll()).object();
+      for (auto it = j.begin(); it != j.end(); ++it)
+        manifest[it.key()] = it.value().toString();
+    }
+  }
+
+  const auto &entries = snapshot.entries;
+  const int n = int(entries.size());
+
+  // Recipe pages, in parallel
+  std::vector<File> files (n);
+  for (int i=0; i<n; i++)
+    files[i].path = QString("recipes/%1.html").arg(entries[i].id);
+
+  std::atomic_int done (0);
+  std::atomic_bool ok (true);
+  QtConcurrent::blockingMap(files, [&] (File &f) {
+    if (cancelled)  return;
+    const auto &e = entries[&f - files.data()];
+    f.contents = page(e.title, e.contents, "../").toUtf8();
+    if (!write(dir, manifest, f)) ok = false;
+    if (progress) progress(++done, n+1);
+  });
+  if (cancelled || !ok)  return false;
+
+  // Everything else
+  QString list;
+  for (const auto &e: entries)
+    list += QString("<li><a href=\"recipes/%1.html\">%2</a></li>\n")
+            .arg(e.id).arg(e.title.toHtmlEscaped());
+
+  QByteArray index = QJsonDocument(searchIndex(snapshot))
+                      .toJson(QJsonDocument::Compact);
+
+  std::vector<File> others {
+    { "index.html", page("Malenda's CookBook",
+                         "<h1>Malenda's CookBook</h1>\n"
+                         "<input id=\"search\" type=\"search\" autofocus "
+                         "placeholder=\"Titre, ingrédient...\">\n"
+                         "<ul id=\"results\"></ul>\n"
+                         "<ul id=\"recipes\">\n" + list + "</ul>\n"
+                         "<script src=\"search-index.js\"></script>\n"
+                         "<script src=\"search.js\"></script>\n",
+                         "").toUtf8(), {} },
+    { "planning.html", page("Planning", "<h1>Planning</h1>\n"
+                                        + snapshot.planning, "").toUtf8(), {} },
+    { "style.css", style, {} },
+    { "search.js", script, {} },
+
+    // The json for other tools, the script for browsers (no fetch on file://)
+    { "search-index.json", index, {} },
+    { "search-index.js", "var searchIndex = " + index + ";\n", {} },
+  };
+  for (File &f: others)
+    if (!write(dir, manifest, f)) return false;
+  if (progress) progress(n+1, n+1);
+
+  // Forget about deleted recipes
+  QSet<QString> current;
+  for (const File &f: files) current.insert(f.path);
+  for (const QString &name: QDir(dir.filePath("recipes"))
+                              .entryList({"*.html"}, QDir::Files)) {
+    QString p = "recipes/" + name;
+    if (!current.contains(p)) dir.remove(p);
+  }
+
+  QJsonObject jmanifest;
+  for (const auto *group: { &files, &others })
+    for (const File &f: *group)
+      jmanifest[f.path] = f.hash;
+  QFile f (dir.filePath(manifestFile));
+  if (!f.open(QIODevice::WriteOnly))  return false;
+  f.write(QJsonDocument(jmanifest).toJson());
+
+  return true;
+}
+
+} // end of namespace db
+
+#endif
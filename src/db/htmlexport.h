@@ -0,0 +1,24 @@
+#ifndef DB_HTMLEXPORT_H
+#define DB_HTMLEXPORT_H
+
+#include "pdfprint.h"
+
+#ifndef Q_OS_ANDROID
+
+namespace db {
+
+/// Default location of the exported site (next to the book file)
+QString siteOutput (void);
+
+/// Static site: index.html (with an offline search), planning.html and one
+/// page per recipe in recipes/. Pages are generated in parallel and only
+/// written if their contents changed since the last export
+bool exportHtml (const PrintSnapshot &snapshot, const QString &dir,
+                 const std::atomic_bool &cancelled,
+                 const PrintProgress &progress);
+
+} // end of namespace db
+
+#endif
+
+#endif // DB_HTMLEXPORT_H
@@ -0,0 +1,398 @@
+#include <QTcpSocket>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QUrlQuery>
+#include <QDateTime>
+
+#include "httpserver.h"
+#include "query.h"
+#include "pdfprint.h"
+
+#include <QDebug>
+
+#ifndef Q_OS_ANDROID
+
+namespace db {
+
+namespace {
+
+/// Requests are a few hundred bytes at most, anything larger is refused
+static constexpr int MaxHeaderSize = 16 * 1024;
+
+/// Below that, deflating is not worth the client's trouble
+static constexpr int MinDeflatedSize = 512;
+
+/// Responses cached for a single revision of the book
+static constexpr size_t MaxCached = 64;
+
+const char* reason (int status) {
+  switch (status) {
+  case 200: return "OK";
+  case 304: return "Not Modified";
+  case 400: return "Bad Request";
+  case 404: return "Not Found";
+  case 405: return "Method Not Allowed";
+  case 431: return "Request Header Fields Too Large";
+  default:  return "Internal Server Error";
+  }
+}
+
+using Headers = QList<QPair<QByteArray, QByteArray>>;
+
+void write (QTcpSocket *socket, int status, Headers headers,
+            const QByteArray &body, bool withBody) {
+  QByteArray r = "HTTP/1.1 " + QByteArray::number(status) + " "
+               + reason(status) + "\r\n";
+  if (status != 304)
+    headers.append({"Content-Length", QByteArray::number(body.size())});
+  for (const auto &h: headers)  r += h.first + ": " + h.second + "\r\n";
+  r += "\r\n";
+  if (withBody && status != 304) r += body;
+  socket->write(r);
+}
+
+QByteArray error (const QString &message) {
+  return QJsonDocument(QJsonObject{{ "error", message }})
+      .toJson(QJsonDocument::Compact);
+}
+
+/// Whether the Accept-Encoding header allows this coding (with a non-zero
+/// quality)
+bool accepts (const QByteArray &header, const QByteArray &coding) {
+  for (const QByteArray &token: header.split(',')) {
+    QList<QByteArray> params = token.split(';');
+    if (params.front().trimmed().toLower() != coding)  continue;
+    for (int i=1; i<params.size(); i++) {
+      QByteArray p = params[i].trimmed();
+      if (p.startsWith("q=") && p.mid(2).toDouble() <= 0) return false;
+    }
+    return true;
+  }
+  return false;
+}
+
+/// Whether the If-None-Match header lists this (quoted) tag
+bool matches (const QByteArray &header, const QByteArray &etag) {
+  for (QByteArray tag: header.split(',')) {
+    tag = tag.trimmed();
+    if (tag.startsWith("W/"))  tag = tag.mid(2);
+    if (tag == "*" || tag == etag)  return true;
+  }
+  return false;
+}
+
+QJsonObject summary (const Recipe &r) {
+  return QJsonObject {
+    {       "id", r.id },
+    {    "title", r.title },
+    { "portions", r.portions },
+    {    "basic", r.basic },
+    {  "regimen", r.regimen->text },
+    {     "type", r.type->text },
+    { "duration", r.duration->text },
+    {   "status", r.status->id },
+  };
+}
+
+QJsonArray summaries (const std::vector<const Recipe*> &recipes) {
+  QJsonArray a;
+  for (const Recipe *r: recipes)  a.append(summary(*r));
+  return a;
+}
+
+QJsonArray quantities (const Book &book, const Expansion::Quantities &q) {
+  QJsonArray a;
+  for (const auto &p: q) {
+    const IngredientData &i = book.ingredients.at(p.first.first);
+    a.append(QJsonObject {
+      { "ingredient", i.text },
+      {      "group", i.group ? QString(i.group->text) : QString() },
+      {       "unit", book.units.at(p.first.second).text },
+      {     "amount", p.second },
+    });
+  }
+  return a;
+}
+
+} // end of anonymous namespace
+
+struct HttpServer::Client {
+  QByteArray buffer;
+};
+
+HttpServer::HttpServer (Book &book, QObject *parent)
+  : QObject(parent), _book(book),
+    // Tags of a previous run must not match
+    _revision(quint64(QDateTime::currentMSecsSinceEpoch()) << 16) {
+
+  connect(&_server, &QTcpServer::newConnection, this, &HttpServer::accept);
+
+  const auto changed = [this] { touch(); };
+  for (QAbstractItemModel *m: std::initializer_list<QAbstractItemModel*>{
+                                &book.recipes, &book.ingredients, &book.units,
+                                &book.planning}) {
+    connect(m, &QAbstractItemModel::dataChanged, this, changed);
+    connect(m, &QAbstractItemModel::rowsInserted, this, changed);
+    connect(m, &QAbstractItemModel::rowsRemoved, this, changed);
+    connect(m, &QAbstractItemModel::modelReset, this, changed);
+    connect(m, &QAbstractItemModel::layoutChanged, this, changed);
+  }
+  connect(&book.shopping, &ShoppingList::changed, this, changed);
+}
+
+HttpServer::~HttpServer (void) {
+  close();
+}
+
+bool HttpServer::listen (quint16 port, const QHostAddress &address) {
+  if (!_server.listen(address, port)) {
+    qWarning("Failed to listen on %s:%d: %s",
+             address.toString().toStdString().c_str(), port,
+             _server.errorString().toStdString().c_str());
+    return false;
+  }
+  qInfo("Serving the book on http://%s:%d",
+        _server.serverAddress().toString().toStdString().c_str(),
+        _server.serverPort());
+  return true;
+}
+
+void HttpServer::close (void) {
+  _server.close();
+  for (const auto &p: _clients) {
+    p.first->disconnect(this);
+    p.first->abort();
+    p.first->deleteLater();
+    delete p.second;
+  }
+  _clients.clear();
+}
+
+void HttpServer::touch (void) {
+  _revision++;
+  _cache.clear();
+}
+
+QByteArray HttpServer::etag (void) const {
+  // Planning and shopping list also depend on the current day
+  return '"' + QByteArray::number(_revision, 36) + "-"
+      + QDate::currentDate().toString("yyyyMMdd").toLatin1() + '"';
+}
+
+void HttpServer::accept (void) {
+  while (QTcpSocket *socket = _server.nextPendingConnection()) {
+    _clients[socket] = new Client;
+    connect(socket, &QTcpSocket::readyRead, this, [this, socket] {
+      read(socket);
+    });
+    connect(socket, &QTcpSocket::disconnected, this, [this, socket] {
+      disconnected(socket);
+    });
+  }
+}
+
+void HttpServer::disconnected (QTcpSocket *socket) {
+  auto it = _clients.find(socket);
+  if (it == _clients.end()) return;
+  delete it->second;
+  _clients.erase(it);
+  socket->deleteLater();
+}
+
+void HttpServer::read (QTcpSocket *socket) {
+  auto it = _clients.find(socket);
+  if (it == _clients.end()) return;
+  QByteArray &buffer = it->second->buffer;
+  buffer += socket->readAll();
+
+  // Several (pipelined) requests may be pending
+  int end;
+  while ((end = buffer.indexOf("\r\n\r\n")) >= 0) {
+    QList<QByteArray> lines = buffer.left(end).split('\n');
+    buffer.remove(0, end + 4);
+
+    QList<QByteArray> request = lines.takeFirst().trimmed().split(' ');
+    if (request.size() != 3 || !request[2].startsWith("HTTP/1.")) {
+      write(socket, 400, {{ "Connection", "close" }},
+            error("Requête invalide"), true);
+      socket->disconnectFromHost();
+      return;
+    }
+
+    QMap<QByteArray, QByteArray> headers;
+    for (const QByteArray &l: lines) {
+      int colon = l.indexOf(':');
+      if (colon > 0)
+        headers[l.left(colon).trimmed().toLower()] = l.mid(colon+1).trimmed();
+    }
+
+    // Bodies are never expected: do not try to stay in sync after one
+    QByteArray connection = headers.value("connection").toLower();
+    bool keepAlive = request[2] == "HTTP/1.1" ? connection != "close"
+                                              : connection == "keep-alive";
+    keepAlive &= !headers.contains("content-length")
+              && !headers.contains("transfer-encoding");
+
+    if (!respond(socket, request[0],
+                 QString::fromUtf8(request[1]), headers, keepAlive)) {
+      socket->disconnectFromHost();
+      return;
+    }
+  }
+
+  if (buffer.size() > MaxHeaderSize) {
+    write(socket, 431, {{ "Connection", "close" }}, QByteArray(), false);
+    socket->disconnectFromHost();
+  }
+}
+
+bool HttpServer::respond (QTcpSocket *socket, const QByteArray &method,
+                          const QString &target,
+                          const QMap<QByteArray, QByteArray> &headers,
+                          bool keepAlive) {
+
+  Headers h {
+    { "Connection", keepAlive ? "keep-alive" : "close" },
+  };
+
+  if (method != "GET" && method != "HEAD") {
+    h.append({ "Allow", "GET, HEAD" });
+    h.append({ "Content-Type", "application/json; charset=utf-8" });
+    write(socket, 405, h, error("Lecture seule"), true);
+    return keepAlive;
+  }
+
+  const QByteArray tag = etag();
+  auto it = _cache.find(target);
+  if (it == _cache.end() || it->second.etag != tag) {
+    if (_cache.size() >= MaxCached) _cache.clear();
+    Cached c;
+    c.response = get(target);
+    c.etag = tag;
+    if (c.response.body.size() >= MinDeflatedSize)
+      c.deflated = qCompress(c.response.body).mid(4);  // raw zlib stream
+    it = _cache.insert_or_assign(target, std::move(c)).first;
+  }
+
+  const Cached &c = it->second;
+  bool deflate = !c.deflated.isEmpty()
+              && accepts(headers.value("accept-encoding"), "deflate");
+
+  h.append({ "Content-Type", "application/json; charset=utf-8" });
+  h.append({ "Cache-Control", "no-cache" });
+  h.append({ "Vary", "Accept-Encoding" });
+
+  if (c.response.status != 200) {
+    write(socket, c.response.status, h, c.response.body, method == "GET");
+    return keepAlive;
+  }
+
+  // Encodings are distinct representations, hence distinct tags
+  QByteArray etag = tag;
+  if (deflate)  etag.insert(etag.size()-1, "-z");
+  h.append({ "ETag", etag });
+
+  if (matches(headers.value("if-none-match"), etag)) {
+    write(socket, 304, h, QByteArray(), false);
+    return keepAlive;
+  }
+
+  if (deflate)  h.append({ "Content-Encoding", "deflate" });
+  write(socket, 200, h, deflate ? c.deflated : c.response.body,
+        method == "GET");
+  return keepAlive;
+}
+
+HttpServer::Response HttpServer::get (const QString &target) {
+  const QUrl url (target);
+  const QStringList path = url.path().split('/', Qt::SkipEmptyParts);
+  const auto ok = [] (const QJsonValue &v) {
+    QJsonDocument d = v.isArray() ? QJsonDocument(v.toArray())
+                                  : QJsonDocument(v.toObject());
+    return Response { 200, d.toJson(QJsonDocument::Compact) };
+  };
+  const auto notFound = [&target] {
+    return Response { 404, error("Introuvable: " + target) };
+  };
+
+  if (path.isEmpty())
+    return ok(QJsonArray { "/recipes", "/recipes/<id>", "/search?q=<requête>",
+                           "/planning", "/shopping" });
+
+  const QString &route = path.front();
+  if (route == "recipes" && path.size() == 1)
+    return ok(summaries(printOrder(_book.recipes)));
+
+  if (route == "recipes" && path.size() == 2) {
+    bool numeric;
+    ID id = ID(path[1].toInt(&numeric));
+    if (!numeric) return notFound();
+    try {
+      const Recipe &r = _book.recipes.at(id);
+      const auto &q = _book.expansion.of(r);
+      QJsonObject o = Recipe::toJson(r).toObject();
+      o["flattened"] = quantities(_book, q);
+      o["lines"] = QJsonArray::fromStringList(_book.expansion.format(q));
+      return ok(o);
+
+    } catch (const std::invalid_argument&) {
+      return notFound();
+    }
+  }
+
+  if (route == "search" && path.size() == 1) {
+    QueryPlan plan;
+    QString message;
+    QString query = QUrlQuery(url).queryItemValue("q", QUrl::FullyDecoded);
+    if (!plan.parse(query, &message))
+      return Response { 400, error(message) };
+
+    std::vector<const Recipe*> recipes;
+    for (const Recipe *r: printOrder(_book.recipes))
+      if (plan.accepts(*r)) recipes.push_back(r);
+    return ok(summaries(recipes));
+  }
+
+  if (route == "planning" && path.size() == 1) {
+    const PlanningModel &planning = _book.planning;
+    QJsonArray days;
+    for (QDate d = QDate::currentDate(); ; d = d.addDays(1)) {
+      QJsonObject meals;
+      for (int m=0; m<PlanningModel::ROWS; m++) {
+        QModelIndex index = planning.cell(d, m);
+        if (!index.isValid()) continue;
+
+        QJsonArray items;
+        for (const QJsonValue &v:
+             index.data(PlanningModel::JsonRole).value<QJsonArray>()) {
+          if (!v.isDouble())  items.append(v);
+          else try {
+            items.append(summary(_book.recipes.at(ID(v.toInt()))));
+          } catch (const std::invalid_argument&) {}
+        }
+        meals[PlanningModel::mealName(m)] = items;
+      }
+      if (meals.isEmpty())  break;
+      days.append(QJsonObject {
+        { "date", d.toString(Qt::ISODate) },
+        { "meals", meals }
+      });
+    }
+    return ok(days);
+  }
+
+  if (route == "shopping" && path.size() == 1) {
+    const auto &q = _book.shopping.total();
+    return ok(QJsonObject {
+      { "flattened", quantities(_book, q) },
+      { "lines", QJsonArray::fromStringList(_book.expansion.format(q)) },
+    });
+  }
+
+  return notFound();
+}
+
+} // end of namespace db
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef DB_HTTPSERVER_H
+#define DB_HTTPSERVER_H
+
+#include <QTcpServer>
+#include <QHostAddress>
+
+#include "book.h"
+
+#ifndef Q_OS_ANDROID
+
+class QTcpSocket;
+
+namespace db {
+
+/// Read-only JSON view of the book over HTTP/1.1 (GET and HEAD):
+///  /                  available routes
+///  /recipes           summary of every recipe
+///  /recipes/<id>      a recipe (as saved) and its flattened ingredients
+///  /search?q=<query>  summary of the matching recipes (see QueryPlan::parse)
+///  /planning          upcoming meals
+///  /shopping          flattened ingredients of the upcoming meals
+///
+/// Every response carries an ETag derived from the book revision so that
+/// polling clients get a bodiless 304 until something changes. Bodies are
+/// deflated for clients that accept it and cached until the next revision.
+class HttpServer : public QObject {
+  Q_OBJECT
+public:
+  HttpServer (Book &book, QObject *parent = nullptr);
+  ~HttpServer (void);
+
+  /// Port 0 picks any free one (see port())
+  bool listen (quint16 port, const QHostAddress &address = QHostAddress::Any);
+  void close (void);
+
+  bool isListening (void) const {
+    return _server.isListening();
+  }
+
+  quint16 port (void) const {
+    return _server.serverPort();
+  }
+
+  QString errorString (void) const {
+    return _server.errorString();
+  }
+
+  struct Response {
+    int status;
+    QByteArray body;            // json
+  };
+
+  /// The json served for a path (with its query). Exposed for the
+  /// command-line tool and debugging
+  Response get (const QString &target);
+
+private:
+  Book &_book;
+  QTcpServer _server;
+  quint64 _revision;
+
+  struct Cached {
+    Response response;
+    QByteArray etag, deflated;
+  };
+  std::map<QString, Cached> _cache;   // by target, for the current revision
+
+  struct Client;
+  std::map<QTcpSocket*, Client*> _clients;
+
+  void touch (void);
+  QByteArray etag (void) const;
+
+  void accept (void);
+  void read (QTcpSocket *socket);
+  void disconnected (QTcpSocket *socket);
+
+  /// Handles a complete request, returns whether to keep the connection open
+  bool respond (QTcpSocket *socket, const QByteArray &method,
+                const QString &target, const QMap<QByteArray, QByteArray> &headers,
+                bool keepAlive);
+};
+
+} // end of namespace db
+
+#endif
+
+#endif // DB_HTTPSERVER_H
@@ -4,7 +4,7 @@
 #include <QVariant>
 #include <QtMath>
 #include <QIcon>
-#include <QApplication>
+#include <QGuiApplication>
 
 #include "ingredientlistentries.h"
 #include "book.h"
@@ -66,7 +66,7 @@ QVariant IngredientEntry::data (int role, double r) const {
     return d;
 
   } else if (role == Qt::DecorationRole)
-    return idata->group->decoration;
+    return idata->group->decoration();
 
   else
     return QVariant();
@@ -109,7 +109,7 @@ QVariant SubRecipeEntry::data (int role, double r) const {
 //    return QIcon::fromTheme("accessories-text-editor");
     return db::MiscIcons::sub_recipe();
   case Qt::ToolTipRole:
-    return recipe->ingredientList(r).join("\n");
+    return recipe->ingredientSummary(r);
   default:
     return QVariant();
   }
@@ -135,7 +135,7 @@ QVariant DecorationEntry::data (int role, double) const {
     return "\n" + text;
 
   else if (role == Qt::FontRole) {
-    auto f = QApplication::font();
+    auto f = QGuiApplication::font();
     f.setItalic(true);
     return f;
 
@@ -56,7 +56,7 @@ struct IngredientEntry : public IngredientListEntry {
     return idata->text;
   }
 
-  const QString& group (void) const {
+  QString group (void) const {
     return idata->group->text;
   }
 };
@@ -58,7 +58,7 @@ QVariant IngredientsModel::data (const QModelIndex &index, int role) const {
     if (index.column() == 0) {
       auto item = atIndex(index.row());
       if (!item.group)  return QVariant();
-      return item.group->decoration;
+      return item.group->decoration();
     } else
       return QVariant();
 
@@ -0,0 +1,321 @@
+#include <random>
+#include <cmath>
+#include <algorithm>
+
+#include <QElapsedTimer>
+#include <QJsonArray>
+
+#include "mealplanner.h"
+
+#include <QDebug>
+
+namespace db {
+
+namespace {
+
+static constexpr double RepeatCost = 100;
+static constexpr double RegimenCost = 10;
+static constexpr double ReuseBonus = 5;
+
+/// Number of candidates looked at for each cell during the greedy pass
+static constexpr size_t GreedySamples = 64;
+
+struct Info {
+  int regimen = -1;             // index in Search::targets (-1: indifferent)
+  bool quick = false;           // allowed on weekdays
+  std::vector<ID> subrecipes;   // all levels, sorted
+};
+
+struct Slot {
+  int day;                      // relative to today (negative: past)
+  int meal;
+  bool weekday;
+  bool free;
+  std::vector<ID> recipes;      // contents (at most one for free slots)
+};
+
+struct Search {
+  const MealPlanner::Options &o;
+  std::map<ID, Info> infos;
+  std::vector<ID> pool, weekdayPool;
+
+  int firstDay;
+  std::vector<Slot> slots;
+  std::vector<std::vector<int>> byDay;
+  std::vector<int> free;
+
+  std::vector<double> targets, counts;
+
+  Search (const MealPlanner::Options &o) : o(o) {}
+
+  const std::vector<int>& day (int d) const {
+    static const std::vector<int> none;
+    d -= firstDay;
+    if (d < 0 || int(byDay.size()) <= d)  return none;
+    return byDay[d];
+  }
+
+  ID current (int s) const {
+    const auto &r = slots[s].recipes;
+    return r.empty() ? INVALID : r.front();
+  }
+
+  const std::vector<ID>& candidates (int s) const {
+    return slots[s].weekday ? weekdayPool : pool;
+  }
+
+  bool allowed (int s, ID id) const {
+    return !slots[s].weekday || infos.at(id).quick;
+  }
+
+  static bool share (const Info &lhs, const Info &rhs) {
+    auto i = lhs.subrecipes.begin(), j = rhs.subrecipes.begin();
+    while (i != lhs.subrecipes.end() && j != rhs.subrecipes.end()) {
+      if (*i < *j)        ++i;
+      else if (*j < *i)   ++j;
+      else                return true;
+    }
+    return false;
+  }
+
+  double pairCost (ID a, ID b, int distance) const {
+    if (a == INVALID || b == INVALID)  return 0;
+    if (a == b)
+      return distance < o.noRepeat ? RepeatCost * (o.noRepeat - distance) : 0;
+    if (distance == 1 && share(infos.at(a), infos.at(b)))
+      return -ReuseBonus;
+    return 0;
+  }
+
+  int regimen (ID id) const {
+    return id == INVALID ? -1 : infos.at(id).regimen;
+  }
+
+  double mixTerm (int r, double c) const {
+    return std::abs(c - targets[r]);
+  }
+
+  double mixDelta (int from, int to) const {
+    if (from == to || targets.empty())  return 0;
+    double d = 0;
+    if (from >= 0)
+      d += mixTerm(from, counts[from]-1) - mixTerm(from, counts[from]);
+    if (to >= 0)
+      d += mixTerm(to, counts[to]+1) - mixTerm(to, counts[to]);
+    return RegimenCost * d;
+  }
+
+  /// Cost variation of replacing the contents of free slot s by b
+  double delta (int s, ID b) const {
+    ID a = current(s);
+    if (a == b) return 0;
+    const Slot &slot = slots[s];
+    int range = std::max(o.noRepeat, 2);
+    double d = mixDelta(regimen(a), regimen(b));
+    for (int dd = slot.day-range+1; dd < slot.day+range; dd++) {
+      int distance = std::abs(dd - slot.day);
+      for (int t: day(dd)) {
+        if (t == s) continue;
+        for (ID x: slots[t].recipes)
+          d += pairCost(b, x, distance) - pairCost(a, x, distance);
+      }
+    }
+    return d;
+  }
+
+  void apply (int s, ID b) {
+    int ra = regimen(current(s)), rb = regimen(b);
+    if (!targets.empty()) {
+      if (ra >= 0)  counts[ra]--;
+      if (rb >= 0)  counts[rb]++;
+    }
+    slots[s].recipes.assign(1, b);
+  }
+};
+
+} // end of anonymous namespace
+
+MealPlanner::Plan MealPlanner::plan (const Options &o, quint32 seed) const {
+  QElapsedTimer timer;
+  timer.start();
+
+  std::mt19937 rng (seed);
+  Search search (o);
+  const RecipeGraph &graph = _recipes.graph();
+
+  // Regimen targets (indexed like the regimens table)
+  double total = 0;
+  for (const auto &p: o.regimens)  total += std::max(0., p.second);
+  if (total > 0)
+    for (const RegimenData &d: RegimenData::database()) {
+      auto it = o.regimens.find(d.id);
+      search.targets.push_back(it != o.regimens.end()
+                               ? std::max(0., it->second) / total : 0);
+    }
+
+  // Recipes
+  for (const auto &p: _recipes) {
+    const Recipe &r = p.second;
+    Info &info = search.infos[r.id];
+    if (r.regimen && !search.targets.empty())
+      info.regimen = int(r.regimen->index());
+    info.quick = !r.duration || r.duration->id <= o.weekdayDuration;
+    auto desc = graph.descendants(r.id);
+    info.subrecipes.assign(desc.begin(), desc.end());
+
+    if (r.basic)  continue;
+    search.pool.push_back(r.id);
+    if (info.quick) search.weekdayPool.push_back(r.id);
+  }
+
+  if (search.pool.empty() || o.days <= 0)  return Plan();
+
+  // Cells
+  QDate today = QDate::currentDate();
+  search.firstDay = 1 - std::max(o.noRepeat, 1);
+  search.byDay.resize(o.days - search.firstDay);
+
+  std::map<int, std::vector<ID>> cooked;  // archived days
+  for (ID id: search.pool) {
+    QDate d = _history.lastCooked(id);
+    if (!d.isValid()) continue;
+    int day = int(today.daysTo(d));
+    if (search.firstDay <= day && day < 0)  cooked[day].push_back(id);
+  }
+
+  const auto addSlot = [&search] (Slot &&slot) {
+    int s = int(search.slots.size());
+    search.byDay[slot.day - search.firstDay].push_back(s);
+    if (slot.free)  search.free.push_back(s);
+    search.slots.push_back(std::move(slot));
+    return s;
+  };
+
+  double filled = 0;
+  for (int day = search.firstDay; day < o.days; day++) {
+    QDate date = today.addDays(day);
+    bool weekday = date.dayOfWeek() <= 5;
+
+    auto it = cooked.find(day);
+    if (it != cooked.end())
+      addSlot(Slot { day, -1, weekday, false, it->second });
+
+    for (int meal=0; meal<PlanningModel::ROWS; meal++) {
+      QModelIndex index = _planning.cell(date, meal);
+      if (!index.isValid()) continue;
+
+      auto jarray = index.data(PlanningModel::JsonRole).value<QJsonArray>();
+      std::vector<ID> contents;
+      for (const QJsonValue &v: jarray)
+        if (v.isDouble() && search.infos.count(ID(v.toInt())))
+          contents.push_back(ID(v.toInt()));
+
+      if (!jarray.empty()) {
+        if (day >= 0)  filled += contents.size();
+        addSlot(Slot { day, meal, weekday, false, contents });
+
+      } else if (day >= 0 && o.meals[meal]
+                 && !(weekday && search.weekdayPool.empty())) {
+        filled++;
+        addSlot(Slot { day, meal, weekday, true, {} });
+      }
+    }
+  }
+
+  if (search.free.empty())  return Plan();
+
+  // Cost of the fixed cells regimen-wise (the rest is constant)
+  double cost = 0;
+  if (!search.targets.empty()) {
+    for (double &t: search.targets) t *= filled;
+    search.counts.resize(search.targets.size(), 0);
+    for (const Slot &slot: search.slots)
+      if (slot.day >= 0)
+        for (ID id: slot.recipes)
+          if (search.regimen(id) >= 0) search.counts[search.regimen(id)]++;
+    for (uint r=0; r<search.targets.size(); r++)
+      cost += RegimenCost * search.mixTerm(r, search.counts[r]);
+  }
+
+  // Greedy construction, chronologically
+  for (int s: search.free) {
+    const auto &candidates = search.candidates(s);
+    ID best = INVALID;
+    double bestDelta = 0;
+    size_t n = std::min(candidates.size(), GreedySamples);
+    std::uniform_int_distribution<size_t> pick (0, candidates.size()-1);
+    for (size_t i=0; i<n; i++) {
+      ID id = candidates.size() <= GreedySamples ? candidates[i]
+                                                 : candidates[pick(rng)];
+      double d = search.delta(s, id);
+      if (best == INVALID || d < bestDelta) {
+        best = id;
+        bestDelta = d;
+      }
+    }
+    search.apply(s, best);
+    cost += bestDelta;
+  }
+
+  // Simulated annealing
+  static constexpr double T0 = RepeatCost / 10, T1 = ReuseBonus / 50;
+  std::vector<ID> best;
+  for (int s: search.free)  best.push_back(search.current(s));
+  double bestCost = cost, temperature = T0;
+
+  std::uniform_real_distribution<double> unit;
+  std::uniform_int_distribution<size_t> slotPick (0, search.free.size()-1);
+  const auto accept = [&] (double d) {
+    return d <= 0 || unit(rng) < std::exp(-d / temperature);
+  };
+
+  uint iterations = 0;
+  for (;; iterations++) {
+    if ((iterations & 255) == 0) {
+      double f = double(timer.elapsed()) / std::max(o.budget, 1);
+      if (f >= 1)  break;
+      temperature = T0 * std::pow(T1 / T0, f);
+    }
+
+    int s = search.free[slotPick(rng)];
+    if (search.free.size() > 1 && unit(rng) < .3) {
+      // Swap the recipes of two cells
+      int t = search.free[slotPick(rng)];
+      ID a = search.current(s), b = search.current(t);
+      if (a == b || !search.allowed(s, b) || !search.allowed(t, a)) continue;
+
+      double d = search.delta(s, b);
+      search.apply(s, b);
+      d += search.delta(t, a);
+      if (accept(d)) {
+        search.apply(t, a);
+        cost += d;
+      } else
+        search.apply(s, a);
+
+    } else {
+      const auto &candidates = search.candidates(s);
+      ID b = candidates[std::uniform_int_distribution<size_t>(
+                          0, candidates.size()-1)(rng)];
+      double d = search.delta(s, b);
+      if (!accept(d)) continue;
+      search.apply(s, b);
+      cost += d;
+    }
+
+    if (cost < bestCost - 1e-9) {
+      bestCost = cost;
+      for (uint i=0; i<search.free.size(); i++)
+        best[i] = search.current(search.free[i]);
+    }
+  }
+
+  Plan plan;
+  for (uint i=0; i<search.free.size(); i++) {
+    const Slot &slot = search.slots[search.free[i]];
+    plan.push_back({ today.addDays(slot.day), slot.meal, best[i] });
+  }
+  return plan;
+}
+
+} // end of namespace db
@@ -0,0 +1,64 @@
+#ifndef DB_MEALPLANNER_H
+#define DB_MEALPLANNER_H
+
+#include <array>
+
+#include "recipesmodel.h"
+#include "planningmodel.h"
+#include "planninghistory.h"
+
+namespace db {
+
+/// Proposes recipes for the empty cells of the planning window. Existing
+/// cells (and recently cooked recipes) are kept as is and taken into account.
+///
+/// The plan is scored on:
+///  - recipes repeated within less than noRepeat days
+///  - distance to the requested regimen shares
+///  - subrecipes shared by consecutive days (a bonus: cook once, eat twice)
+/// Long recipes are never proposed on weekdays.
+///
+/// A greedy pass builds a first plan which is then improved by simulated
+/// annealing (with incremental cost updates) until the time budget is spent.
+class MealPlanner {
+public:
+  struct Options {
+    int days = 7;
+    std::array<bool, PlanningModel::ROWS> meals {{ true, false, true }};
+
+    /// Longest allowed duration on weekdays (DurationData id)
+    ID weekdayDuration = ID(1);
+
+    /// Minimal number of days between two occurrences of a recipe
+    int noRepeat = 7;
+
+    /// Wanted share of each regimen. Missing/empty means indifferent
+    std::map<ID, double> regimens;
+
+    /// Search time, in milliseconds
+    int budget = 250;
+  };
+
+  struct Assignment {
+    QDate date;
+    int meal;
+    ID recipe;
+  };
+  using Plan = std::vector<Assignment>;
+
+  MealPlanner (const RecipesModel &recipes, const PlanningModel &planning,
+               const PlanningHistory &history)
+    : _recipes(recipes), _planning(planning), _history(history) {}
+
+  /// Proposal for the empty cells, starting today
+  Plan plan (const Options &o, quint32 seed = 0) const;
+
+private:
+  const RecipesModel &_recipes;
+  const PlanningModel &_planning;
+  const PlanningHistory &_history;
+};
+
+} // end of namespace db
+
+#endif // DB_MEALPLANNER_H
@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <iterator>
+
+#include "pantry.h"
+
+#include <QDebug>
+
+namespace db {
+
+const Pantry::IngredientSet& Pantry::ingredients(const Recipe &r) {
+  if (!_valid)  rebuild();
+  return _ingredients.at(r.id);
+}
+
+const Pantry::RecipeList& Pantry::users(ID ingredient, bool deep) {
+  static const RecipeList none;
+  if (!_valid)  rebuild();
+  const auto &map = deep ? _users : _directUsers;
+  auto it = map.find(ingredient);
+  return it != map.end() ? it->second : none;
+}
+
+Pantry::Matches Pantry::rank(const IngredientSet &available) {
+  if (!_valid)  rebuild();
+
+  std::map<const Recipe*, int> hits;
+  for (ID i: available) {
+    auto it = _users.find(i);
+    if (it == _users.end()) continue;
+    for (const Recipe *r: it->second) hits[r]++;
+  }
+
+  Matches matches;
+  matches.reserve(hits.size());
+  for (const auto &[r, covered]: hits) {
+    const IngredientSet &needed = _ingredients.at(r->id);
+    Match m { r, covered, int(needed.size()), {} };
+    std::set_difference(needed.begin(), needed.end(),
+                        available.begin(), available.end(),
+                        std::inserter(m.missing, m.missing.end()));
+    matches.push_back(std::move(m));
+  }
+
+  std::sort(matches.begin(), matches.end(),
+            [] (const Match &lhs, const Match &rhs) {
+    if (lhs.coverage() != rhs.coverage())
+      return lhs.coverage() > rhs.coverage();
+    if (lhs.missing.size() != rhs.missing.size())
+      return lhs.missing.size() < rhs.missing.size();
+    return Recipe::titleLess(*lhs.recipe, *rhs.recipe);
+  });
+
+  return matches;
+}
+
+void Pantry::rebuild(void) {
+  _ingredients.clear();
+  _users.clear();
+  _directUsers.clear();
+
+  // Subrecipes come first: each recipe is flattened in a single pass
+  for (ID id: _recipes.graph().topologicalOrder()) {
+    const Recipe &r = _recipes.at(id);
+    IngredientSet &set = _ingredients[id];
+    for (const auto &e: r.ingredients)
+      if (e->etype == EntryType::Ingredient)
+        set.insert(static_cast<const IngredientEntry&>(*e).idata->id);
+    for (ID sub: _recipes.graph().subrecipes(id)) {
+      const IngredientSet &subset = _ingredients.at(sub);
+      set.insert(subset.begin(), subset.end());
+    }
+  }
+
+  for (const auto &p: _recipes) {
+    for (ID i: _ingredients.at(p.first))
+      _users[i].push_back(&p.second);
+
+    for (const auto &e: p.second.ingredients) {
+      if (e->etype != EntryType::Ingredient)  continue;
+      auto &list = _directUsers[static_cast<const IngredientEntry&>(*e).idata->id];
+      if (list.empty() || list.back() != &p.second) list.push_back(&p.second);
+    }
+  }
+
+  _valid = true;
+}
+
+} // end of namespace db
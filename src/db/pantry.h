@@ -0,0 +1,57 @@
+#ifndef DB_PANTRY_H
+#define DB_PANTRY_H
+
+#include "recipesmodel.h"
+
+namespace db {
+
+/// Answers "what can I cook with these ingredients?" over the whole book.
+/// Each recipe is reduced once to the set of ingredients it needs (subrecipes
+/// included) and an inverted index maps each ingredient to its users. Both are
+/// rebuilt lazily after any modification of the recipes.
+class Pantry {
+public:
+  using IngredientSet = std::set<ID>;
+
+  struct Match {
+    const Recipe *recipe;
+    int covered, total;
+    IngredientSet missing;
+
+    double coverage (void) const {
+      return total > 0 ? double(covered) / total : 0;
+    }
+  };
+  using Matches = std::vector<Match>;
+
+  Pantry (const RecipesModel &recipes) : _recipes(recipes) {}
+
+  /// Recipes using at least one of the available ingredients, best covered
+  /// first
+  Matches rank (const IngredientSet &available);
+
+  /// All ingredients needed by the recipe, subrecipes included
+  const IngredientSet& ingredients (const Recipe &r);
+
+  using RecipeList = std::vector<const Recipe*>;
+
+  /// Recipes using an ingredient directly or (if deep) through a subrecipe
+  const RecipeList& users (ID ingredient, bool deep);
+
+  void invalidate (void) {
+    _valid = false;
+  }
+
+private:
+  const RecipesModel &_recipes;
+
+  bool _valid = false;
+  std::map<ID, IngredientSet> _ingredients;
+  std::map<ID, RecipeList> _users, _directUsers;
+
+  void rebuild (void);
+};
+
+} // end of namespace db
+
+#endif // DB_PANTRY_H
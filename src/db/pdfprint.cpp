@@ -1,48 +1,146 @@
 #include <algorithm>
-#include <fstream>
-#include <filesystem>
+#include <sstream>
 
+#include <QGuiApplication>
+#include <QScreen>
+#include <QPdfWriter>
+#include <QPainter>
+#include <QTextDocument>
+#include <QtConcurrent>
+#include <QTextStream>
+#include <QCryptographicHash>
+#include <QProcess>
+#include <QDir>
+#include <QEventLoop>
+#include <QJsonArray>
+
+#include "pdfprint.h"
 #include "book.h"
+#include "printjob.h"
 
 #include <QDebug>
 
 #ifndef Q_OS_ANDROID
 
 namespace db {
-//   double amount;
-//   UnitData *unit;
-//   IngredientData *idata;
-//   QString qualif;
 
-void printRecipe(std::ofstream &ofs, const Recipe &r) {
+std::vector<const Recipe*> printOrder (const RecipesModel &recipes,
+                                       const IDSet *selection) {
+  std::vector<const Recipe*> sortedRecipes;
+  if (selection) {
+    sortedRecipes.reserve(selection->size());
+    for (ID id: *selection) sortedRecipes.push_back(&recipes.at(id));
+  } else {
+    sortedRecipes.reserve(recipes.rowCount());
+    for (const auto &[id, recipe]: recipes)
+      sortedRecipes.push_back(&recipe);
+  }
+  std::sort(sortedRecipes.begin(), sortedRecipes.end(),
+            [] (auto *lhs, auto *rhs) {
+              return Recipe::titleLess(*lhs, *rhs);
+            });
+  return sortedRecipes;
+}
+
+IDSet withSubrecipes (const RecipesModel &recipes, const IDSet &selection) {
+  IDSet closure = selection;
+  for (ID id: selection) {
+    IDSet d = recipes.graph().descendants(id);
+    closure.insert(d.begin(), d.end());
+  }
+  return closure;
+}
+
+QString recipeToHtml (const Recipe &r, const SubRecipeLink &link) {
+  QString html;
+  QTextStream ts (&html);
+  bool hasNotes = !r.notes.isEmpty();
+
+  ts << "<h1>" << r.title.toHtmlEscaped() << "</h1>\n";
+
+  if (hasNotes)
+    ts << "<table width=\"100%\"><tr><td width=\"50%\" valign=\"top\">\n";
+
+  ts << "<h3>Pour " << r.portions << " " << r.portionsLabel.toHtmlEscaped()
+     << "</h3>\n<ul>\n";
+  for (const auto &e: r.ingredients) {
+    if (e->etype == EntryType::Ingredient)
+      ts << " <li>" << e->data(Qt::DisplayRole, 1).toString().toHtmlEscaped()
+         << "</li>\n";
+
+    else if (e->etype == EntryType::SubRecipe)
+      ts << " <li>" << link(*static_cast<const SubRecipeEntry&>(*e).recipe)
+         << "</li>\n";
+
+    else if (e->etype == EntryType::Decoration)
+      ts << "</ul>\n<p><b>"
+         << static_cast<const DecorationEntry&>(*e).text.toHtmlEscaped()
+         << "</b></p>\n<ul>\n";
+  }
+  ts << "</ul>\n";
+
+  if (hasNotes)
+    ts << "</td><td width=\"50%\" valign=\"top\">\n"
+       << "<h3>Notes:</h3>\n<p>"
+       << r.notes.toHtmlEscaped().replace("\n", "<br/>") << "</p>\n"
+       << "</td></tr></table>\n";
+
+  ts << "<h3>Etapes</h3>\n<ol>\n";
+  for (const auto &step: r.steps)
+    ts << " <li>" << step.toHtmlEscaped() << "</li>\n";
+  ts << "</ol>\n";
+
+  ts.flush();
+  return html;
+}
+
+/// Characters with a special meaning in LaTeX
+std::string tex (const QString &s) {
+  static const std::map<QChar, QString> special {
+    { '\\', "\\textbackslash{}" }, { '{', "\\{" }, { '}', "\\}" },
+    { '&', "\\&" }, { '%', "\\%" }, { '$', "\\$" }, { '#', "\\#" },
+    { '_', "\\_" }, { '~', "\\textasciitilde{}" },
+    { '^', "\\textasciicircum{}" }
+  };
+  QString escaped;
+  escaped.reserve(s.size());
+  for (const QChar &c: s) {
+    auto it = special.find(c);
+    if (it != special.end())  escaped += it->second;
+    else                      escaped += c;
+  }
+  return escaped.toStdString();
+}
+
+void printRecipe(std::ostream &ofs, const Recipe &r) {
   bool hasNotes = !r.notes.isEmpty();
 
-  ofs << "\\section{" << r.title.toStdString() << "}\n";
-  ofs << "\\label{recipe:" << r.title.toStdString() << "}\n\n";
+  ofs << "\\section{" << tex(r.title) << "}\n";
+  ofs << "\\hypertarget{recipe:" << r.id << "}{}\n\n";
 
   if (hasNotes)
     ofs << "\\begin{minipage}[t]{.49\\textwidth}\n";
 
-  ofs << "\\subsection*{Pour " << r.portions << " " << r.portionsLabel.toStdString() << "}\n\n";
+  ofs << "\\subsection*{Pour " << r.portions << " " << tex(r.portionsLabel) << "}\n\n";
   ofs << " \\begin{itemize}\n";
   for (const auto &e: r.ingredients) {
     if (e->etype == EntryType::Ingredient) {
       const auto &i = static_cast<const IngredientEntry&>(*e);
       ofs << "  \\item " << i.amount;
       if (i.unit->text != "Ø")
-        ofs << " " << i.unit->text.toStdString();
-      ofs << " " << i.idata->text.toStdString();
+        ofs << " " << tex(i.unit->text);
+      ofs << " " << tex(i.idata->text);
       if (!i.qualif.isEmpty())
-        ofs << " (" << i.qualif.toStdString() << ")";
+        ofs << " (" << tex(i.qualif) << ")";
 
     } else if (e->etype == EntryType::SubRecipe) {
       const auto &_r = static_cast<const SubRecipeEntry&>(*e);
-      const auto title = _r.recipe->title.toStdString();
-      ofs << "  \\item \\hyperlink{recipe:" << title << "}{" << title << "}\n";
+      ofs << "  \\item \\hyperlink{recipe:" << _r.recipe->id << "}{"
+          << tex(_r.recipe->title) << "}\n";
 
     } else if (e->etype == EntryType::Decoration) {
       const auto &d = static_cast<const DecorationEntry&>(*e);
-      ofs << "\\end{itemize}\n\\paragraph{" << d.text.toStdString() << "}\n"
+      ofs << "\\end{itemize}\n\\paragraph{" << tex(d.text) << "}\n"
           << R"(\begin{itemize})" << "\n";
 
     } else {
@@ -56,60 +154,146 @@ void printRecipe(std::ofstream &ofs, const Recipe &r) {
     ofs << "\\end{minipage}\n";
     ofs << "\\begin{minipage}[t]{.49\\textwidth}\n";
     ofs << "\\subsection*{Notes:}\n";
-    ofs << r.notes.toStdString() << "\n";
+    ofs << tex(r.notes) << "\n";
     ofs << "\\end{minipage}\n";
   }
 
   ofs << "\\subsection*{Etapes}\n";
   ofs << "\\begin{enumerate}\n";
   for (const auto &step: r.steps)
-    ofs << " \\item " << step.toStdString() << "\n";
+    ofs << " \\item " << tex(step) << "\n";
   ofs << "\\end{enumerate}\n";
 }
 
-bool Book::print(void) {
-  qDebug() << "Printing";
+namespace {
 
-//   QPrinter printer(QPrinter::PrinterResolution);
-//   printer.setOutputFormat(QPrinter::PdfFormat);
-//   printer.setPageSize(QPageSize(QPageSize::A4));
-//
-//   QString filename(monitoredPath());
-//   filename.replace(extension(), "pdf");
-//   printer.setOutputFileName(filename);
-//
-//   QTextDocument doc;
-//
-//   QString html;
-//   QTextStream stream (&html);
-//
-//   stream << "<h1>Hello, Malenda!</h1>\n";
-//   stream << "<p>Lorem ipsum dolor sit amet, consectitur adipisci elit.</p>";
-//
-// //   doc.setPageSize(printer.pageRect().size()); // This is necessary if you want to hide the page number
-//
-//   for (const auto &[id, recipe]: recipes)
-//       stream << "<h2>" << recipe.title << "</h2>\n";
-//
-//   doc.setHtml(html);
-//   doc.print(&printer);
-
-  // Sort recipes alphabetically
-  std::vector<const Recipe*> sortedRecipes;
-  sortedRecipes.reserve(recipes.rowCount());
-  for (const auto &[id, recipe]: recipes)
-    sortedRecipes.push_back(&recipe);
-  std::sort(sortedRecipes.begin(), sortedRecipes.end(),
-            [] (auto *lhs, auto *rhs) {
-              return lhs->title < rhs->title;
-            });
+QByteArray readAll (const QString &path) {
+  QFile f (path);
+  return f.open(QIODevice::ReadOnly) ? f.readAll() : QByteArray();
+}
+
+/// Only touches the file if its contents change. Returns whether it did
+bool writeIfChanged (const QString &path, const QByteArray &contents) {
+  if (QFile::exists(path) && readAll(path) == contents) return false;
+  QFile f (path);
+  if (!f.open(QIODevice::WriteOnly)) {
+    qWarning() << "Could not write to" << path;
+    return false;
+  }
+  f.write(contents);
+  return true;
+}
+
+} // end of anonymous namespace
+
+QString printOutput (void) {
+  return QString(Book::monitoredPath()).replace(Book::extension(), "pdf");
+}
+
+QString pageMarker (ID id) {
+  return QChar(1) + QString::number(id) + QChar(2);
+}
+
+PrintSnapshot::PrintSnapshot (const Book &book, Format format,
+                              const IDSet *selection)
+  : format(format), dpi(96) {
+  // Screens are only known to the gui thread
+  if (format == PDF && QGuiApplication::primaryScreen())
+    dpi = QGuiApplication::primaryScreen()->logicalDotsPerInchY();
+
+  IDSet closure;
+  if (selection)  closure = withSubrecipes(book.recipes, *selection);
+  const auto exported = [selection, &closure] (ID id) {
+    return !selection || closure.count(id);
+  };
+
+  for (const Recipe *r: printOrder(book.recipes,
+                                   selection ? &closure : nullptr)) {
+    Entry e { r->id, r->title, QString(), {}, {} };
+    if (format == PDF)
+      e.contents = recipeToHtml(*r, [&e] (const Recipe &s) {
+        e.references.push_back(s.id);
+        return QString("%1 <i>(p. %2)</i>")
+            .arg(s.title.toHtmlEscaped(), pageMarker(s.id));
+      });
+
+    else if (format == HTML) {
+      e.contents = recipeToHtml(*r, [&e] (const Recipe &s) {
+        e.references.push_back(s.id);
+        return QString("<a href=\"%1.html\">%2</a>")
+            .arg(s.id).arg(s.title.toHtmlEscaped());
+      });
+      e.keywords.append(r->title);
+      for (const auto &i: r->ingredients)
+        if (i->etype == EntryType::Ingredient)
+          e.keywords.append(static_cast<const IngredientEntry&>(*i).type());
+        else if (i->etype == EntryType::SubRecipe)
+          e.keywords.append(
+            static_cast<const SubRecipeEntry&>(*i).recipe->title);
+
+    } else {
+      std::ostringstream fragment;
+      printRecipe(fragment, *r);
+      fragment << R"(\vfill\small\hyperlink{toc}{Table of Contents})" << "\n\n";
+      fragment << R"(\newpage)" << "\n\n";
+      e.contents = QString::fromStdString(fragment.str());
+    }
+    entries.push_back(std::move(e));
+  }
+
+  if (format == HTML) {
+    const PlanningModel &p = book.planning;
+    QTextStream ts (&planning);
+    ts << "<table>\n<tr><th></th>";
+    for (int m=0; m<PlanningModel::ROWS; m++)
+      ts << "<th>" << PlanningModel::mealName(m).toHtmlEscaped() << "</th>";
+    ts << "</tr>\n";
+    for (int c=0; c<p.columnCount(); c++) {
+      QDate date = p.date(p.index(0, c));
+      if (date < QDate::currentDate())  continue;
+      ts << "<tr><th>" << date.toString("dddd d MMMM") << "</th>";
+      for (int m=0; m<PlanningModel::ROWS; m++) {
+        QStringList items;
+        for (const QJsonValue &v: p.cell(date, m).data(PlanningModel::JsonRole)
+                                                  .value<QJsonArray>()) {
+          if (v.isDouble()) {
+            const Recipe &r = book.recipes.at(ID(v.toInt()));
+            if (exported(r.id))
+              items.append(QString("<a href=\"recipes/%1.html\">%2</a>")
+                           .arg(r.id).arg(r.title.toHtmlEscaped()));
+            else
+              items.append(r.title.toHtmlEscaped());
+          } else
+            items.append(v.toString().toHtmlEscaped());
+        }
+        ts << "<td>" << items.join("<br/>") << "</td>";
+      }
+      ts << "</tr>\n";
+    }
+    ts << "</table>\n";
+    ts.flush();
+  }
+}
+
+/// Each recipe is written to its own fragment (_latex/recipes/<id>-<hash>.tex)
+/// which the main file only \input-s. Fragments are named after their contents
+/// so unchanged recipes are never rewritten and nothing is compiled if the
+/// whole book is unchanged
+LatexBuild writeLatex (const PrintSnapshot &snapshot) {
+  Q_ASSERT(snapshot.format == PrintSnapshot::LATEX);
 
-  QString workFolder = monitoredDir() + "/_latex";
-  std::filesystem::create_directories(workFolder.toStdString());
+  QDir dir (Book::monitoredDir() + "/_latex");
+  dir.mkpath("recipes");
+  QDir fragments (dir.filePath("recipes"));
 
-  QString outfile = (workFolder + "/" + monitoredName().replace(extension(), "tex"));
-  qDebug() << "Writing to" << outfile;
-  std::ofstream ofs (outfile.toStdString());
+  LatexBuild build;
+  build.dir = dir.path();
+  build.tex = Book::monitoredName().replace(Book::extension(), "tex");
+  QString stem = build.tex.chopped(3);
+  build.toc = dir.filePath(stem + "toc");
+  build.pdf = dir.filePath(stem + "pdf");
+
+  std::ostringstream ofs;
   ofs << R"(\documentclass{article})" << "\n";
   ofs << R"(\usepackage{hyperref})" << "\n";
   ofs << R"(\begin{document})" << "\n";
@@ -120,31 +304,224 @@ bool Book::print(void) {
   ofs << R"(\tableofcontents)" << "\n";
   ofs << R"(\newpage)" << "\n\n";
 
-  for (const auto *recipe_ptr: sortedRecipes) {
-    const auto &r = *recipe_ptr;
-    printRecipe(ofs, r);
-    ofs << R"(\vfill\small\hyperlink{toc}{Table of Contents})" << "\n\n";
-    ofs << R"(\newpage)" << "\n\n";
+  QSet<QString> used;
+  int regenerated = 0;
+  for (const auto &e: snapshot.entries) {
+    QByteArray contents = e.contents.toUtf8();
+    QString name = QString("%1-%2.tex").arg(e.id).arg(QString(
+      QCryptographicHash::hash(contents, QCryptographicHash::Sha1)
+        .toHex().left(16)));
+    used.insert(name);
+    if (!fragments.exists(name)) {
+      writeIfChanged(fragments.filePath(name), contents);
+      regenerated++;
+    }
+    ofs << "\\input{recipes/" << name.chopped(4).toStdString() << "}\n";
   }
 
   ofs << R"(\end{document})" << "\n";
-  ofs.close();
 
-  auto cmd = (QString("pdflatex --interaction=nonstopmode --output-directory ")
-              + workFolder + " " + outfile).toStdString();
-  for (auto i=0; i<2; i++) {
-    auto r = system(cmd.c_str());
-    (void)r;
+  for (const QString &name: fragments.entryList({"*.tex"}, QDir::Files))
+    if (!used.contains(name)) fragments.remove(name);
+
+  bool changed = writeIfChanged(dir.filePath(build.tex),
+                                QByteArray::fromStdString(ofs.str()));
+  build.upToDate = !changed && regenerated == 0 && QFile::exists(build.pdf);
+  return build;
+}
+
+bool Book::printLatex(void) {
+  PrintJob job (*this, PrintSnapshot::LATEX);
+  QEventLoop loop;
+  bool ok = false, done = false;
+  connect(&job, &PrintJob::finished, [&loop, &ok, &done] (bool success) {
+    ok = success;
+    done = true;
+    loop.quit();
+  });
+  job.start();
+  if (!done)  loop.exec();
+  return ok;
+}
+
+namespace {
+
+/// A4, with room for the page number at the bottom. Documents are laid out in
+/// screen pixels (as QTextDocument does without a paint device) and scaled
+/// to the writer's resolution when painted
+struct PageSetup {
+  QPageLayout layout;
+  qreal dpi;
+
+  PageSetup (qreal dpi)
+    : layout(QPageSize(QPageSize::A4), QPageLayout::Portrait,
+             QMarginsF(20, 20, 20, 25), QPageLayout::Millimeter),
+      dpi(dpi) {}
+
+  QSizeF size (void) const {
+    return layout.paintRectPoints().size() * dpi / 72.;
+  }
+
+  qreal footer (void) const {
+    return layout.margins(QPageLayout::Point).bottom() * dpi / 72.;
+  }
+};
+
+using Document = QSharedPointer<QTextDocument>;
+
+/// Thread-safe: each document lives on its own until handed to the painter
+/// (on the thread running printPdf, which also destroys it)
+Document paginate (const QString &html, const QSizeF &size) {
+  auto doc = Document::create();
+  doc->setHtml(html);
+  doc->setPageSize(size);
+  doc->pageCount();
+  return doc;
+}
+
+} // end of anonymous namespace
+
+bool printPdf (const PrintSnapshot &snapshot, const QString &path,
+               const std::atomic_bool &cancelled,
+               const PrintProgress &progress) {
+  Q_ASSERT(snapshot.format == PrintSnapshot::PDF);
+
+  const auto &entries = snapshot.entries;
+  const int n = int(entries.size());
+  const PageSetup setup (snapshot.dpi);
+  const QSizeF size = setup.size();
+
+  std::map<ID, int> position;
+  for (int i=0; i<n; i++) position[entries[i].id] = i;
+
+  // Internal links do not survive QPdfWriter: refer to page numbers instead
+  std::vector<int> firstPage (n, 0);
+  bool numbered = false;
+  const auto pageNumber = [&] (int i) {
+    return numbered ? QString::number(firstPage[i]) : QString("000");
+  };
+
+  const auto tocHtml = [&] {
+    QString html;
+    QTextStream ts (&html);
+    ts << "<h1 align=\"center\">Malenda's CookBook</h1>\n"
+       << "<p align=\"center\"><i>With love</i></p>\n"
+       << "<h2>Table of Contents</h2>\n"
+       << "<table width=\"100%\">\n";
+    for (int i=0; i<n; i++)
+      ts << "<tr><td>" << entries[i].title.toHtmlEscaped()
+         << "</td><td align=\"right\">" << pageNumber(i) << "</td></tr>\n";
+    ts << "</table>\n";
+    ts.flush();
+    return html;
+  };
+
+  // Progress: every recipe laid out once, then painted
+  std::atomic_int done (0);
+  const auto advance = [&] {
+    int d = ++done;
+    if (progress) progress(d, 2*n);
+  };
+
+  struct Job {
+    int index;
+    Document doc;
+  };
+  std::vector<Job> jobs (n);
+  for (int i=0; i<n; i++)  jobs[i] = { i, Document() };
+
+  const auto layoutRecipes = [&] (bool linkedOnly) {
+    QtConcurrent::blockingMap(jobs, [&] (Job &j) {
+      const auto &e = entries[j.index];
+      if (cancelled || (linkedOnly && e.references.empty())) return;
+
+      QString html = e.contents;
+      for (ID id: e.references)
+        html.replace(pageMarker(id), pageNumber(position.at(id)));
+      j.doc = paginate(html, size);
+      if (!linkedOnly)  advance();
+    });
+  };
+
+  // Placeholders first, then the actual page numbers until they are stable
+  Document toc = paginate(tocHtml(), size);
+  layoutRecipes(false);
+  for (int pass = 0; pass < 3 && !cancelled; pass++) {
+    std::vector<int> pages (n);
+    int page = toc->pageCount() + 1;
+    for (int i=0; i<n; i++) {
+      pages[i] = page;
+      page += jobs[i].doc->pageCount();
+    }
+    if (numbered && pages == firstPage) break;
+
+    firstPage = pages;
+    numbered = true;
+    layoutRecipes(true);
+  }
+  if (cancelled)  return false;
+  toc = paginate(tocHtml(), size);
+
+  // Only replace the previous version once complete
+  QString tmp = path + ".part";
+  QPdfWriter writer (tmp);
+  writer.setPageLayout(setup.layout);
+  writer.setTitle("Malenda's CookBook");
+  writer.setCreator(QCoreApplication::applicationName());
+
+  QPainter painter;
+  if (!painter.begin(&writer)) {
+    qWarning() << "Could not write to" << tmp;
+    return false;
   }
+  qreal scale = writer.resolution() / setup.dpi;
+  painter.scale(scale, scale);
 
-  QString outpdf = outfile.chopped(3) + "pdf";
-  QString pdf (monitoredPath());
-  pdf.replace(extension(), "pdf");
-  std::filesystem::rename(outpdf.toStdString(), pdf.toStdString());
+  int page = 1;
+  const auto paint = [&] (QTextDocument &doc) {
+    for (int p=0; p<doc.pageCount(); p++, page++) {
+      if (page > 1) writer.newPage();
+
+      QRectF clip (0, p * size.height(), size.width(), size.height());
+      painter.save();
+      painter.translate(0, -clip.top());
+      doc.drawContents(&painter, clip);
+      painter.restore();
+
+      painter.drawText(QRectF(0, size.height(), size.width(), setup.footer()),
+                       Qt::AlignCenter, QString::number(page));
+    }
+  };
+
+  paint(*toc);
+  for (Job &j: jobs) {
+    if (cancelled)  break;
+    paint(*j.doc);
+    advance();
+  }
+  painter.end();
+
+  if (cancelled) {
+    QFile::remove(tmp);
+    return false;
+  }
+
+  QFile::remove(path);
+  if (!QFile::rename(tmp, path)) {
+    qWarning() << "Could not produce" << path;
+    return false;
+  }
 
   return true;
 }
 
+bool Book::print(void) {
+  qDebug() << "Printing";
+  std::atomic_bool never (false);
+  return printPdf(PrintSnapshot(*this, PrintSnapshot::PDF), printOutput(),
+                  never, nullptr);
+}
+
 } // end of namespace db
 
 #endif
@@ -0,0 +1,77 @@
+#ifndef DB_PDFPRINT_H
+#define DB_PDFPRINT_H
+
+#include <functional>
+#include <atomic>
+
+#include "recipesmodel.h"
+
+#ifndef Q_OS_ANDROID
+
+namespace db {
+
+struct Book;
+
+using IDSet = RecipeGraph::IDSet;
+
+/// Recipes in the order of the printed book (alphabetical), all of them or
+/// only the selected ones
+std::vector<const Recipe*> printOrder (const RecipesModel &recipes,
+                                       const IDSet *selection = nullptr);
+
+/// The selection and every subrecipe it needs
+IDSet withSubrecipes (const RecipesModel &recipes, const IDSet &selection);
+
+/// Html shown in place of a subrecipe (e.g. a link or a page reference)
+using SubRecipeLink = std::function<QString(const Recipe &subrecipe)>;
+
+/// Same structure as the LaTeX output: ingredients (with notes aside), steps
+QString recipeToHtml (const Recipe &r, const SubRecipeLink &link);
+
+/// Where the printed book ends up (next to the book file)
+QString printOutput (void);
+
+/// Everything needed to print the book, copied from the models so that the
+/// printing can proceed in the background while the book is being edited
+struct PrintSnapshot {
+  enum Format { PDF, LATEX, HTML };
+
+  struct Entry {
+    ID id;
+    QString title;
+    QString contents;   // Html (page references to resolve, or links) or LaTeX
+    std::vector<ID> references;
+    QStringList keywords;       // HTML only: what the search index knows of
+  };
+
+  Format format;
+  std::vector<Entry> entries;   // in print order
+  QString planning;             // HTML only: upcoming meals
+  qreal dpi;                    // PDF only: of the screen, for the layout
+
+  /// The whole book or the selected recipes (with their subrecipes)
+  PrintSnapshot (const Book &book, Format format,
+                 const IDSet *selection = nullptr);
+};
+
+using PrintProgress = std::function<void(int done, int total)>;
+
+/// Renders the book with QTextDocument/QPdfWriter. Safe to call from any
+/// thread. Recipes are laid out in parallel
+bool printPdf (const PrintSnapshot &snapshot, const QString &path,
+               const std::atomic_bool &cancelled,
+               const PrintProgress &progress);
+
+struct LatexBuild {
+  QString dir, tex, toc, pdf;
+  bool upToDate;  // no need to run pdflatex
+};
+
+/// Writes the LaTeX sources, incrementally, in the _latex folder
+LatexBuild writeLatex (const PrintSnapshot &snapshot);
+
+} // end of namespace db
+
+#endif
+
+#endif // DB_PDFPRINT_H
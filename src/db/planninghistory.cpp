@@ -0,0 +1,117 @@
+#include <algorithm>
+
+#include <QJsonArray>
+
+#include "planninghistory.h"
+
+namespace db {
+
+void PlanningHistory::append(const QDate &date,
+                             const std::vector<ID> &recipes) {
+  if (recipes.empty())  return;
+
+  const qint64 day = date.toJulianDay();
+  auto it = std::lower_bound(_days.begin(), _days.end(), day);
+  size_t i = std::distance(_days.begin(), it);
+
+  // Usually at the end, otherwise shift the following days
+  if (it == _days.end() || *it != day) {
+    _days.insert(it, day);
+    _offsets.insert(_offsets.begin() + i + 1, _offsets[i]);
+  }
+  _recipes.insert(_recipes.begin() + _offsets[i+1],
+                  recipes.begin(), recipes.end());
+  for (size_t j=i+1; j<_offsets.size(); j++)  _offsets[j] += recipes.size();
+
+  for (ID r: recipes) {
+    qint64 &last = _last[r];
+    last = std::max(last, day);
+  }
+}
+
+void PlanningHistory::remove(ID recipe) {
+  if (!_last.erase(recipe))  return;
+
+  std::vector<qint64> days;
+  std::vector<quint32> offsets { 0 };
+  std::vector<ID> recipes;
+  for (size_t i=0; i<_days.size(); i++) {
+    for (quint32 k=_offsets[i]; k<_offsets[i+1]; k++)
+      if (_recipes[k] != recipe)  recipes.push_back(_recipes[k]);
+    if (recipes.size() == offsets.back())  continue;
+    days.push_back(_days[i]);
+    offsets.push_back(quint32(recipes.size()));
+  }
+  _days.swap(days);
+  _offsets.swap(offsets);
+  _recipes.swap(recipes);
+}
+
+QDate PlanningHistory::lastCooked(ID recipe) const {
+  auto it = _last.find(recipe);
+  if (it == _last.end())  return QDate();
+  return QDate::fromJulianDay(it->second);
+}
+
+PlanningHistory::Counts PlanningHistory::counts(int days) const {
+  const qint64 since = QDate::currentDate().addDays(-days).toJulianDay();
+  size_t i = std::distance(_days.begin(),
+                           std::lower_bound(_days.begin(), _days.end(), since));
+  Counts c;
+  for (auto it = _recipes.begin() + _offsets[i]; it != _recipes.end(); ++it)
+    c[*it]++;
+  return c;
+}
+
+std::function<bool(ID)> PlanningHistory::forgottenSince(int months) const {
+  const qint64 limit = QDate::currentDate().addMonths(-months).toJulianDay();
+  return [this, limit] (ID recipe) {
+    auto it = _last.find(recipe);
+    return it == _last.end() || it->second < limit;
+  };
+}
+
+QJsonObject PlanningHistory::toJson(void) const {
+  QJsonArray days, offsets, recipes;
+  for (qint64 d: _days) days.append(int(d));
+  for (quint32 o: _offsets) offsets.append(int(o));
+  for (ID r: _recipes) recipes.append(r);
+  return QJsonObject {
+    { "days", days }, { "offsets", offsets }, { "recipes", recipes }
+  };
+}
+
+void PlanningHistory::fromJson(const QJsonObject &j) {
+  _days.clear();
+  _offsets = { 0 };
+  _recipes.clear();
+  _last.clear();
+
+  const QJsonArray days = j["days"].toArray(),
+                   offsets = j["offsets"].toArray(),
+                   recipes = j["recipes"].toArray();
+  bool valid = (offsets.size() == days.size() + 1
+                && offsets.first().toInt(-1) == 0
+                && offsets.last().toInt(-1) == recipes.size());
+  for (int i=1; valid && i<offsets.size(); i++)
+    valid = (offsets[i-1].toInt() <= offsets[i].toInt()
+             && (i == 1 || days[i-2].toInt() < days[i-1].toInt()));
+  if (!valid) {
+    if (!days.isEmpty())  qWarning("Ignoring malformed planning history");
+    return;
+  }
+
+  _days.reserve(days.size());
+  _offsets.reserve(offsets.size());
+  _recipes.reserve(recipes.size());
+  for (const QJsonValue &v: days) _days.push_back(v.toInt());
+  for (int i=1; i<offsets.size(); i++)
+    _offsets.push_back(quint32(offsets[i].toInt()));
+  for (const QJsonValue &v: recipes)  _recipes.push_back(ID(v.toInt()));
+
+  for (size_t i=0; i<_days.size(); i++)
+    for (quint32 k=_offsets[i]; k<_offsets[i+1]; k++)
+      _last[_recipes[k]] = _days[i];
+}
+
+} // end of namespace db
@@ -0,0 +1,56 @@
+#ifndef DB_PLANNINGHISTORY_H
+#define DB_PLANNINGHISTORY_H
+
+#include <functional>
+#include <map>
+#include <vector>
+
+#include <QDate>
+#include <QJsonObject>
+
+#include "recipedata.h"
+
+namespace db {
+
+/// Recipes actually planned on past days, archived by PlanningModel::clearOld.
+/// Stored column-wise: the sorted days, the offset of each day's first
+/// recipe and the flat list of recipe IDs. Free text entries are not kept.
+class PlanningHistory {
+public:
+  /// Default period (in days) for "recent" statistics
+  static constexpr int RecentDays = 90;
+
+  using Counts = std::map<ID, int>;
+
+  void append (const QDate &date, const std::vector<ID> &recipes);
+
+  /// Forgets a deleted recipe (its ID may be reused), drops emptied days
+  void remove (ID recipe);
+
+  size_t days (void) const {
+    return _days.size();
+  }
+
+  /// Invalid date if never cooked
+  QDate lastCooked (ID recipe) const;
+
+  /// Number of times each recipe was cooked in the last days
+  Counts counts (int days = RecentDays) const;
+
+  /// Whether a recipe was not cooked in the last months (or never)
+  std::function<bool(ID)> forgottenSince (int months) const;
+
+  QJsonObject toJson (void) const;
+  void fromJson (const QJsonObject &j);
+
+private:
+  std::vector<qint64> _days;            // Julian day numbers
+  std::vector<quint32> _offsets { 0 };  // days()+1 entries
+  std::vector<ID> _recipes;
+
+  std::map<ID, qint64> _last;
+};
+
+} // end of namespace db
+
+#endif // DB_PLANNINGHISTORY_H
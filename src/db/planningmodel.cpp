@@ -1,8 +1,9 @@
+#include <algorithm>
+
 #include <QJsonArray>
 #include <QMimeData>
-#include <QApplication>
+#include <QGuiApplication>
 #include <QPalette>
-#include <QStyle>
 #include <QFontMetrics>
 
 #include "planningmodel.h"
@@ -17,12 +18,14 @@ std::array<QString, PlanningModel::ROWS> hheaders {
   "Midi", "Goûter", "Soir"
 };
 
+PlanningModel::Icons PlanningModel::icons;
+
 QIcon PlanningModel::recipeLinkIcon(void) {
-  return QApplication::style()->standardIcon(QStyle::SP_FileDialogInfoView);
+  return icons.recipeLink;
 }
 
 QIcon PlanningModel::rawTextIcon(void) {
-  return QApplication::style()->standardIcon(QStyle::SP_FileIcon);
+  return icons.rawText;
 }
 
 struct PlanningModel::Data {
@@ -38,7 +41,7 @@ struct PlanningModel::Data {
 
     virtual QIcon decoration (void) const = 0;
     static QIcon defaultDecoration (void) {
-      return QApplication::style()->standardIcon(QStyle::SP_DirIcon);
+      return icons.folder;
     }
 
     virtual QJsonValue toJson (void) const = 0;
@@ -88,7 +91,7 @@ struct PlanningModel::Data {
   };
   struct CMP {
     static bool lower (const RecipeItem &lhs, const RecipeItem &rhs) {
-      return lhs.recipe->title < rhs.recipe->title;
+      return lhs.recipe->id < rhs.recipe->id;
     }
 
     static bool lower (const StringItem &lhs, const StringItem &rhs) {
@@ -111,6 +114,19 @@ struct PlanningModel::Data {
   using PSet = std::set<Item::ptr_t, CMP>;
   std::array<PSet, ROWS> data;
 
+  /// What the views ask for, computed on first use after a modification
+  struct Cache {
+    bool valid = false;
+    QString display, tooltip;
+    QVariant decoration;
+  };
+  mutable std::array<Cache, ROWS> cache;
+
+  const Cache& rendered (int row) const;
+  void invalidate (int row) {
+    cache.at(row).valid = false;
+  }
+
   Data (const QDate &d) : date(d) {}
   Data (const QJsonValue &j)
     : Data(QDate::fromString(j.toString(), Qt::ISODate)) {}
@@ -170,13 +186,13 @@ int PlanningModel::rowCount(const QModelIndex&) const {
 }
 
 int PlanningModel::columnCount(const QModelIndex&) const {
-  return _data.size();
+  return int(_data.size());
 }
 
 #else
 
 int PlanningModel::rowCount(const QModelIndex&) const {
-  return (ROWS+2) * _data.size() - 1;
+  return (ROWS+2) * int(_data.size()) - 1;
 }
 
 int PlanningModel::columnCount(const QModelIndex&) const {
@@ -228,6 +244,23 @@ QVariant decoration (const Set &set) {
     return PlanningModel::Data::Item::defaultDecoration();
 }
 
+const PlanningModel::Data::Cache&
+PlanningModel::Data::rendered (int row) const {
+  Cache &c = cache.at(row);
+  if (!c.valid) {
+    const PSet &set = data.at(row);
+    c.tooltip = formatRecipeList(set, "\n");
+#ifndef Q_OS_ANDROID
+    c.display = formatRecipeList(set, " & ");
+#else
+    c.display = c.tooltip;
+#endif
+    c.decoration = db::decoration(set);
+    c.valid = true;
+  }
+  return c;
+}
+
 QVariant PlanningModel::data (const QModelIndex &i, int role) const {
 #ifndef Q_OS_ANDROID
   auto dayData = [this] (const QModelIndex &i) {
@@ -236,6 +269,9 @@ QVariant PlanningModel::data (const QModelIndex &i, int role) const {
   auto cellData = [dayData] (const QModelIndex &i) {
     return dayData(i)->data.at(i.row());
   };
+  auto rendered = [dayData] (const QModelIndex &i) -> const Data::Cache& {
+    return dayData(i)->rendered(i.row());
+  };
 #else
   auto dayData = [this] (const QModelIndex &i) {
     return _data.at(i.row() / (ROWS+2));
@@ -243,6 +279,9 @@ QVariant PlanningModel::data (const QModelIndex &i, int role) const {
   auto cellData = [dayData] (const QModelIndex &i) {
     return dayData(i)->data.at(i.row() % (ROWS+2) - 1);
   };
+  auto rendered = [dayData] (const QModelIndex &i) -> const Data::Cache& {
+    return dayData(i)->rendered(i.row() % (ROWS+2) - 1);
+  };
   bool dateCell = ((i.row() % (ROWS+2)) == 0);
   bool separator = ((i.row() % (ROWS+2)) == ROWS+1);
 #endif
@@ -250,13 +289,13 @@ QVariant PlanningModel::data (const QModelIndex &i, int role) const {
   switch (role) {
 #ifndef Q_OS_ANDROID
   case Qt::DisplayRole:
-    return formatRecipeList(cellData(i), " & ");
+    return rendered(i).display;
   case Qt::ToolTipRole:
-    return formatRecipeList(cellData(i), "\n");
+    return rendered(i).tooltip;
   case Qt::DecorationRole:
-    return decoration(cellData(i));
+    return rendered(i).decoration;
   case Qt::ForegroundRole:
-    return QApplication::palette().color(
+    return QGuiApplication::palette().color(
       dayData(i)->date < db::fakeToday() ? QPalette::Disabled
                                          : QPalette::Active,
       QPalette::WindowText);
@@ -268,10 +307,10 @@ QVariant PlanningModel::data (const QModelIndex &i, int role) const {
     else if (dateCell)
       return formatDate(dayData(i)->date);
     else
-      return formatRecipeList(cellData(i), "\n");
+      return rendered(i).display;
 
   case Qt::DecorationRole:
-    return (separator || dateCell) ? QVariant() : decoration(cellData(i));
+    return (separator || dateCell) ? QVariant() : rendered(i).decoration;
 
   case Qt::FontRole: {
     QFont f;
@@ -283,20 +322,20 @@ QVariant PlanningModel::data (const QModelIndex &i, int role) const {
     return dateCell ? Qt::AlignCenter : Qt::AlignLeft;
 
   case Qt::ForegroundRole: {
-    auto c = QApplication::palette().color(QPalette::Active,
-                                           QPalette::WindowText);
+    auto c = QGuiApplication::palette().color(QPalette::Active,
+                                              QPalette::WindowText);
     if (dayData(i)->date < db::fakeToday()) c = c.darker();
     return c;
   }
   case Qt::BackgroundRole: {
-    auto c = dateCell? QApplication::palette().alternateBase()
-                     : QApplication::palette().base();
+    auto c = dateCell? QGuiApplication::palette().alternateBase()
+                     : QGuiApplication::palette().base();
     if (dayData(i)->date < db::fakeToday()) c = c.color().lighter();
     return c;
   }
   case Qt::SizeHintRole:
     if (!separator) return QVariant();
-    return QSize(0, .5*QApplication::fontMetrics().height());
+    return QSize(0, .5*QFontMetrics(QGuiApplication::font()).height());
 #endif
 
   case IDRole:
@@ -318,80 +357,108 @@ QVariant PlanningModel::data (const QModelIndex &i, int role) const {
 #ifndef Q_OS_ANDROID
 Qt::ItemFlags PlanningModel::flags (const QModelIndex &index) const {
   auto f = QAbstractItemModel::flags(index) | Qt::ItemIsDropEnabled;
-  if (!index.data().toString().isEmpty()) f |= Qt::ItemIsDragEnabled;
+  if (!_data.at(index.column())->data.at(index.row()).empty())
+    f |= Qt::ItemIsDragEnabled;
   return f;
 }
 
 QMimeData* PlanningModel::mimeData(const QModelIndexList &indexes) const {
-  QMimeData *d = QAbstractTableModel::mimeData(indexes);
+  RecipeMimeData *d = new RecipeMimeData;
   Q_ASSERT(indexes.size() == 1);
   d->setText(indexes.front().data().toString());
 
-  QJsonArray jarray;
-  for (const QModelIndex &i: indexes)
-     for (const QJsonValue &v: data(i, JsonRole).value<QJsonArray>())
-       jarray.append(v);
+  for (const QModelIndex &i: indexes) {
+    for (const Data::Item::ptr_t &item: _data.at(i.column())->data.at(i.row())) {
+      if (item->type() == Data::Item::RECIPE)
+        d->recipes.push_back(
+          static_cast<const Data::RecipeItem&>(*item).recipe->id);
+      else
+        d->texts.append(static_cast<const Data::StringItem&>(*item).text);
+    }
+  }
 
-  d->setData(Recipe::MimeType, toByteArray(jarray));
-  qDebug() << "dragMimeData" << d->text() << d->data(Recipe::MimeType);
-  d->setProperty("src", indexes.front());
+  d->source = indexes.front();
   return d;
 }
 
 bool PlanningModel::dropMimeData(const QMimeData *data, Qt::DropAction action,
-                                 int row, int column,
-                                 const QModelIndex &parent) {
-  auto q = qDebug().nospace();
-  q << "dropMimeData(" << data << " " << action << " " << row << " " << column
-    << " " << parent << ")\n";
-  if (!parent.isValid()) {
-    q << ">> Invalid index. Aborting\n";
+                                 int, int, const QModelIndex &parent) {
+  if (!parent.isValid())  return false;
+
+  std::vector<ID> recipes;
+  QStringList texts;
+  if (!RecipeMimeData::read(data, recipes, texts))  return false;
+
+  if (!setItems(parent, recipes, texts, bool(action & MergeAction)))
     return false;
-  }
-  QJsonArray jarray = fromByteArray(data->data(Recipe::MimeType));
-  q << "input: " << jarray << "\n";
-  if (action & MergeAction) {
-    q << "Try to merge with current data\n";
-    for (const QJsonValue &v: parent.data(JsonRole).value<QJsonArray>())
-      jarray.append(v);
-  }
-  auto r = setData(parent, jarray, JsonRole);
-  if (!r) return false;
   if (action != Qt::MoveAction) return true;
-  QModelIndex srcIndex = data->property("src").toModelIndex();
-  return setData(srcIndex, QVariant(), JsonRole);
+
+  auto d = qobject_cast<const RecipeMimeData*>(data);
+  if (!d || !d->source.isValid()) return true;
+  return setItems(d->source, {}, {});
 }
 
 bool PlanningModel::setData (const QModelIndex &index, const QVariant &value,
                              int role) {
   if (role == JsonRole) {
-    QJsonArray jarray = value.toJsonArray();
-    Data::PSet &set = _data.at(index.column())->data.at(index.row());
-    set.clear();
-    for (const QJsonValue &v: jarray)
-      set.insert(Data::Item::fromJson(v));
-    if (jarray.size() != int(set.size())) return false;
-    emit dataChanged(index, index, {role});
-    return true;
+    std::vector<ID> recipes;
+    QStringList texts;
+    for (const QJsonValue &v: value.toJsonArray()) {
+      if (v.isDouble()) recipes.push_back(ID(v.toInt()));
+      else              texts.append(v.toString());
+    }
+    return setItems(index, recipes, texts);
 
   } else
     return QAbstractTableModel::setData(index, value, role);
 }
 
+bool PlanningModel::setItems(const QModelIndex &index,
+                             const std::vector<ID> &recipes,
+                             const QStringList &texts, bool merge) {
+  Data &day = *_data.at(index.column());
+  Data::PSet &set = day.data.at(index.row());
+  Data::PSet items;
+  if (merge)  items = set;
+
+  size_t expected = items.size() + recipes.size() + texts.size();
+  for (ID id: recipes)
+    items.insert(Data::Item::ptr_t(new Data::RecipeItem(id)));
+  for (const QString &t: texts)
+    items.insert(Data::Item::ptr_t(new Data::StringItem(t)));
+  if (items.size() != expected) return false;
+
+  set = std::move(items);
+  day.invalidate(index.row());
+  emit dataChanged(index, index, {JsonRole});
+  return true;
+}
+
 void PlanningModel::addItem(const QModelIndex &index, const QString &item) {
-  _data.at(index.column())->data.at(index.row()).insert(Data::Item::fromJson(item));
+  Data &day = *_data.at(index.column());
+  day.data.at(index.row()).insert(Data::Item::fromJson(item));
+  day.invalidate(index.row());
   emit dataChanged(index, index, {Qt::DisplayRole});
 }
 
 void PlanningModel::clearOld(void) {
-  int old=0;
-  while (_data[old]->date < db::fakeToday())  old++;
-  qDebug() << "Want to clean" << old << "old planning days";
+  int old = std::clamp(slot(db::fakeToday()), 0, int(_data.size()));
   if (old > 0) {
+    auto &history = Book::current().history;
+    for (int i=0; i<old; i++) {
+      std::vector<ID> recipes;
+      for (const Data::PSet &set: _data[i]->data)
+        for (const Data::Item::ptr_t &item: set)
+          if (item->type() == Data::Item::RECIPE)
+            recipes.push_back(
+              static_cast<const Data::RecipeItem&>(*item).recipe->id);
+      history.append(_data[i]->date, recipes);
+    }
+
     beginRemoveColumns(QModelIndex(), 0, old-1);
-    for (int i=0; i<old; i++) _data.removeFirst();
+    _data.erase(_data.begin(), _data.begin() + old);
+    _origin = _origin.addDays(old);
     endRemoveColumns();
-    emit dataChanged(index(0, 0), index(ROWS, old-1));
   }
 }
 #endif
@@ -402,10 +469,24 @@ void PlanningModel::fromJson (const QJsonArray &j) {
   auto q = qDebug().nospace();
   q << "Reading model from json\n";
 
+  std::vector<Data_ptr> days;
   for (const QJsonValue &v: j)
-    _data.push_back(Data::fromJson(v.toArray()));
+    days.push_back(Data::fromJson(v.toArray()));
+
+  _data.clear();
+  if (!days.empty()) {
+    const auto [first, last] = std::minmax_element(
+      days.begin(), days.end(),
+      [] (const Data_ptr &lhs, const Data_ptr &rhs) {
+        return lhs->date < rhs->date;
+    });
+    _origin = (*first)->date;
+    for (int i=0; i<=slot((*last)->date); i++)
+      _data.push_back(Data_ptr::create(_origin.addDays(i)));
+    for (const Data_ptr &d: days) _data[slot(d->date)] = d;
+  }
 
-  q << "Read " << _data.size() << " items\n";
+  q << "Read " << days.size() << " items over " << _data.size() << " days\n";
 
   endResetModel();
 
@@ -416,31 +497,47 @@ void PlanningModel::fromJson (const QJsonArray &j) {
 
 #ifndef Q_OS_ANDROID
 void PlanningModel::populateModel(void) {
-  beginResetModel();
   auto prevsize = _data.size();
   QDate today = db::fakeToday();
   int range = Settings::value<int>(Settings::PLANNING_WINDOW);
-  int offset = 0;
-  while (offset < _data.size() && _data[offset]->date < today)  offset++;
-  for (int i=0; i<range; i++) {
-    int j = offset+i;
-    QDate date = today.addDays(i);
-    if (j >= _data.size()  // Not present
-     || date < _data[j]->date)  // Next is in the future
-      _data.insert(j, Data_ptr::create(date));
+
+  if (_data.empty())  _origin = today;
+
+  // Days between today and the first known one
+  int before = today.daysTo(_origin);
+  if (before > 0) {
+    beginInsertColumns(QModelIndex(), 0, before-1);
+    for (int i=before-1; i>=0; i--)
+      _data.push_front(Data_ptr::create(today.addDays(i)));
+    _origin = today;
+    endInsertColumns();
+  }
+
+  // Missing days in the planning window
+  int end = slot(today) + range, size = int(_data.size());
+  if (size < end) {
+    beginInsertColumns(QModelIndex(), size, end-1);
+    for (int i=size; i<end; i++)
+      _data.push_back(Data_ptr::create(_origin.addDays(i)));
+    endInsertColumns();
   }
 
-  int i=_data.size()-1;
-  while (i >= 0 && today.addDays(range) <= _data[i]->date) {
-    if (_data[i]->empty()) _data.removeAt(i);
-    i--;
+  // Empty days beyond the planning window
+  size = int(_data.size());
+  int last = size;
+  while (last > end && _data[last-1]->empty()) last--;
+  if (last < size) {
+    beginRemoveColumns(QModelIndex(), last, size-1);
+    _data.resize(last);
+    endRemoveColumns();
   }
 
   qDebug() << "Model size after auto-populate: " << _data.size() << "(+"
-           << (_data.size() - prevsize) << ")";
-  endResetModel();
+           << (int(_data.size()) - int(prevsize)) << ")";
 }
 
+#endif
+
 QJsonArray PlanningModel::toJson (void) const {
   QJsonArray j;
   for (const auto &d: _data)
@@ -448,19 +545,87 @@ QJsonArray PlanningModel::toJson (void) const {
       j.append(d->toJson());
   return j;
 }
+
+void PlanningModel::merge (const QJsonArray &days,
+                           const std::vector<QDate> &removed) {
+  const auto date = [] (const QJsonValue &v) {
+    return QDate::fromString(v.toArray().first().toString(), Qt::ISODate);
+  };
+
+  std::map<QDate, QJsonValue> all;
+  for (const QJsonValue &v: toJson()) all[date(v)] = v;
+  for (const QDate &d: removed) all.erase(d);
+  for (const QJsonValue &v: days) all[date(v)] = v;
+
+  QJsonArray j;
+  for (const auto &p: all)  j.append(p.second);
+  fromJson(j);
+}
+
+QDate PlanningModel::date (const QModelIndex &index) const {
+#ifndef Q_OS_ANDROID
+  return _data.at(index.column())->date;
+#else
+  int r = index.row() % (ROWS+2);
+  if (r == 0 || r == ROWS+1)  return QDate();
+  return _data.at(index.row() / (ROWS+2))->date;
 #endif
+}
 
-QModelIndex PlanningModel::todayOrLatter (void) const {
-  for (int i=0; i<_data.size(); i++) {
-    if (_data[i]->date == today()) {
+QModelIndex PlanningModel::cell (const QDate &date, int meal) const {
+  int i = slot(date);
+  if (i < 0 || int(_data.size()) <= i || meal < 0 || ROWS <= meal)
+    return QModelIndex();
 #ifndef Q_OS_ANDROID
-      return index(0, i);
+  return index(meal, i);
 #else
-      return index(i*(ROWS+2), 0);
+  return index(i*(ROWS+2)+meal+1, 0);
 #endif
+}
+
+std::set<ID> PlanningModel::recipes (const QDate &from,
+                                     const QDate &to) const {
+  std::set<ID> ids;
+  int first = std::max(slot(from), 0);
+  int last = std::min(slot(to), int(_data.size())-1);
+  for (int i=first; i<=last; i++)
+    for (const Data::PSet &set: _data[i]->data)
+      for (const Data::Item::ptr_t &item: set)
+        if (item->type() == Data::Item::RECIPE)
+          ids.insert(static_cast<const Data::RecipeItem&>(*item).recipe->id);
+  return ids;
+}
+
+void PlanningModel::recipeModified (ID id) {
+  for (const Data_ptr &d: _data) {
+    for (int r=0; r<ROWS; r++) {
+      const Data::PSet &set = d->data[r];
+      if (std::none_of(set.begin(), set.end(),
+                       [id] (const Data::Item::ptr_t &item) {
+            return item->type() == Data::Item::RECIPE
+                && static_cast<const Data::RecipeItem&>(*item).recipe->id == id;
+          }))
+        continue;
+
+      d->invalidate(r);
+      QModelIndex index = cell(d->date, r);
+      emit dataChanged(index, index, {Qt::DisplayRole, Qt::ToolTipRole});
     }
   }
-  return QModelIndex();
+}
+
+const QString& PlanningModel::mealName (int meal) {
+  return hheaders.at(meal);
+}
+
+QModelIndex PlanningModel::todayOrLatter (void) const {
+  int i = slot(today());
+  if (i < 0 || int(_data.size()) <= i) return QModelIndex();
+#ifndef Q_OS_ANDROID
+  return index(0, i);
+#else
+  return index(i*(ROWS+2), 0);
+#endif
 }
 
 } // end of namespace db
@@ -1,6 +1,9 @@
 #ifndef PLANNINGMODEL_H
 #define PLANNINGMODEL_H
 
+#include <deque>
+#include <set>
+
 #include <QAbstractTableModel>
 
 #include "recipe.h"
@@ -13,6 +16,12 @@ public:
   static constexpr auto MergeAction = Qt::DropAction((int(Qt::ActionMask)+1)>>1);
   static constexpr auto JsonRole = IDRole+1;
 
+  /// Style dependent, provided by the gui (null icons otherwise)
+  struct Icons {
+    QIcon recipeLink, rawText, folder;
+  };
+  static Icons icons;
+
   static QIcon recipeLinkIcon (void);
   static QIcon rawTextIcon (void);
 
@@ -49,21 +58,47 @@ public:
 
   void addItem (const QModelIndex &index, const QString &item);
 
+  /// Replaces (or extends, if merging) the contents of a cell. Fails, without
+  /// modifying anything, if an item would be duplicated
+  bool setItems (const QModelIndex &index, const std::vector<ID> &recipes,
+                 const QStringList &texts, bool merge = false);
+
   void clearOld (void);
 #endif
 
   void fromJson (const QJsonArray &j);
-
-#ifndef Q_OS_ANDROID
   QJsonArray toJson (void) const;
-#endif
+
+  /// Replaces (or adds) these days and empties the removed ones
+  void merge (const QJsonArray &days, const std::vector<QDate> &removed);
 
   QModelIndex todayOrLatter (void) const;
 
+  /// Day of a meal cell (invalid for the other cells on android)
+  QDate date (const QModelIndex &index) const;
+
+  /// Cell of a meal (0 to ROWS-1) on a day (invalid if outside the planning)
+  QModelIndex cell (const QDate &date, int meal) const;
+
+  static const QString& mealName (int meal);
+
+  /// Recipes planned between the two dates (included)
+  std::set<ID> recipes (const QDate &from, const QDate &to) const;
+
+  /// Refreshes the cells displaying this recipe (e.g. after a renaming)
+  void recipeModified (ID id);
+
   struct Data;
 private:
   using Data_ptr = QSharedPointer<Data>;
-  QList<Data_ptr> _data;
+
+  /// One slot per day, without gaps, starting at _origin
+  QDate _origin;
+  std::deque<Data_ptr> _data;
+
+  int slot (const QDate &date) const {
+    return _origin.daysTo(date);
+  }
 
 #ifndef Q_OS_ANDROID
   void populateModel (void);
@@ -0,0 +1,122 @@
+#include <QtConcurrent>
+#include <QFile>
+
+#include "printjob.h"
+#include "htmlexport.h"
+
+#include <QDebug>
+
+#ifndef Q_OS_ANDROID
+
+namespace db {
+
+/// Two runs are needed for the table of contents
+static constexpr int LatexPasses = 2;
+
+static QByteArray contents (const QString &path) {
+  QFile f (path);
+  return f.open(QIODevice::ReadOnly) ? f.readAll() : QByteArray();
+}
+
+PrintJob::PrintJob (const Book &book, PrintSnapshot::Format format,
+                    const QString &output, const IDSet *selection,
+                    QObject *parent)
+  : QObject(parent), _snapshot(book, format, selection), _output(output),
+    _cancelled(false), _process(nullptr), _pass(0) {
+
+  if (_output.isEmpty())
+    _output = (format == PrintSnapshot::HTML) ? siteOutput() : printOutput();
+
+  connect(&_watcher, &QFutureWatcher<bool>::finished, [this] {
+    emit finished(!_cancelled && _watcher.result());
+  });
+}
+
+PrintJob::~PrintJob (void) {
+  cancel();
+  _watcher.waitForFinished();
+}
+
+void PrintJob::start (void) {
+  const PrintProgress report = [this] (int done, int total) {
+    emit progress(done, total);
+  };
+
+  if (_snapshot.format == PrintSnapshot::PDF)
+    _watcher.setFuture(QtConcurrent::run([this, report] {
+      return printPdf(_snapshot, _output, _cancelled, report);
+    }));
+
+  else if (_snapshot.format == PrintSnapshot::HTML)
+    _watcher.setFuture(QtConcurrent::run([this, report] {
+      return exportHtml(_snapshot, _output, _cancelled, report);
+    }));
+
+  else {
+    _latex = writeLatex(_snapshot);
+    if (_latex.upToDate)
+      deliver();
+    else {
+      // So that a failed run cannot deliver the previous document
+      QFile::remove(_latex.pdf);
+      compile();
+    }
+  }
+}
+
+void PrintJob::cancel (void) {
+  _cancelled = true;
+  if (_process) _process->kill();
+}
+
+void PrintJob::compile (void) {
+  emit progress(_pass, LatexPasses);
+  _toc = contents(_latex.toc);
+
+  _process = new QProcess(this);
+  _process->setWorkingDirectory(_latex.dir);
+  _process->setProcessChannelMode(QProcess::MergedChannels);
+
+  connect(_process, &QProcess::errorOccurred,
+          [this] (QProcess::ProcessError error) {
+    if (error != QProcess::FailedToStart) return;
+    qWarning() << "Could not run pdflatex:" << _process->errorString();
+    _process->deleteLater();
+    _process = nullptr;
+    emit finished(false);
+  });
+
+  connect(_process,
+          QOverload<int,QProcess::ExitStatus>::of(&QProcess::finished),
+          [this] (int, QProcess::ExitStatus exitStatus) {
+    _process->deleteLater();
+    _process = nullptr;
+
+    // pdflatex reports errors in the document with a non-zero exit code
+    // but still produces (most of) it
+    if (_cancelled || exitStatus != QProcess::NormalExit) {
+      emit finished(false);
+      return;
+    }
+
+    _pass++;
+    if (_pass < LatexPasses && contents(_latex.toc) != _toc)
+      compile();
+    else
+      deliver();
+  });
+
+  _process->start("pdflatex", {"--interaction=nonstopmode", _latex.tex});
+}
+
+void PrintJob::deliver (void) {
+  emit progress(LatexPasses, LatexPasses);
+  QFile::remove(_output);
+  bool ok = QFile::copy(_latex.pdf, _output);
+  if (!ok)  qWarning() << "Could not produce" << _output;
+  emit finished(ok);
+}
+
+} // end of namespace db
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef DB_PRINTJOB_H
+#define DB_PRINTJOB_H
+
+#include <QObject>
+#include <QProcess>
+#include <QFutureWatcher>
+
+#include "pdfprint.h"
+
+#ifndef Q_OS_ANDROID
+
+namespace db {
+
+/// Prints a snapshot of the book in the background: the native PDF renderer
+/// and the site export run on a worker thread, pdflatex as an asynchronous
+/// process. Any can be cancelled at any time
+class PrintJob : public QObject {
+  Q_OBJECT
+public:
+  /// Output defaults to printOutput() for PDF/LaTeX and siteOutput() for HTML
+  PrintJob (const Book &book, PrintSnapshot::Format format,
+            const QString &output = QString(),
+            const IDSet *selection = nullptr, QObject *parent = nullptr);
+  ~PrintJob (void);
+
+  void start (void);
+  void cancel (void);
+
+  bool isCancelled (void) const {
+    return _cancelled;
+  }
+
+signals:
+  void progress (int done, int total);
+
+  /// Also emitted, with false, upon cancellation
+  void finished (bool ok);
+
+private:
+  PrintSnapshot _snapshot;
+  QString _output;
+  std::atomic_bool _cancelled;
+
+  QFutureWatcher<bool> _watcher;
+
+  LatexBuild _latex;
+  QProcess *_process;
+  int _pass;
+  QByteArray _toc;
+
+  void compile (void);
+  void deliver (void);
+};
+
+} // end of namespace db
+
+#endif
+
+#endif // DB_PRINTJOB_H
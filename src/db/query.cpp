@@ -0,0 +1,369 @@
+#include <algorithm>
+#include <bitset>
+
+#include <QElapsedTimer>
+
+#include "query.h"
+#include "book.h"
+
+namespace db {
+
+QString normalized (const QString &s) {
+  const QString d = s.normalized(QString::NormalizationForm_D);
+  QString n;
+  n.reserve(d.size());
+  for (QChar c: d)
+    if (c.category() != QChar::Mark_NonSpacing) n.append(c.toLower());
+  return n;
+}
+
+namespace {
+
+struct Term {
+  bool negated = false;
+  QString key, op, value;
+
+  QString toString (void) const {
+    QString s = negated ? "-" : "";
+    if (!key.isEmpty()) s += key + ":" + op;
+    return s + value;
+  }
+};
+using Alternatives = QList<Term>;
+
+/// Anything else before a ':' is plain text (e.g. "Tarte: pommes")
+const QSet<QString>& keys (void) {
+  static const QSet<QString> k {
+    "titre", "title", "ing", "ingredient", "qualif", "groupe", "group",
+    "sous", "sub", "recette", "basique", "basic", "regime", "type", "duree",
+    "statut", "status", "oubli", "forgotten", "cuisine", "cooked"
+  };
+  return k;
+}
+
+bool fail (QString *error, const QString &message) {
+  if (error)  *error = message;
+  return false;
+}
+
+bool tokenize (const QString &q, QList<Alternatives> &clauses,
+               QString *error) {
+  static const QStringList operators { "<=", ">=", "<", ">", "=" };
+  bool pendingOr = false;
+  int i = 0;
+  const int n = q.size();
+  while (i < n) {
+    if (q[i].isSpace()) {
+      i++;
+      continue;
+    }
+
+    if (q[i] == '|') {
+      pendingOr = true;
+      i++;
+      continue;
+    }
+
+    Term t;
+    if (q[i] == '-') {
+      t.negated = true;
+      i++;
+    }
+
+    QString word;
+    bool quoted = false;
+    while (i < n && !q[i].isSpace() && q[i] != '|') {
+      if (q[i] == '"') {
+        int end = q.indexOf('"', i+1);
+        if (end < 0)  return fail(error, "Guillemet non fermé");
+        word += q.mid(i+1, end-i-1);
+        quoted = true;
+        i = end+1;
+
+      } else if (q[i] == ':' && t.key.isEmpty() && !quoted
+                 && keys().contains(normalized(word))) {
+        t.key = normalized(word);
+        word.clear();
+        i++;
+        for (const QString &op: operators) {
+          if (q.mid(i, op.size()) == op) {
+            t.op = op;
+            i += op.size();
+            break;
+          }
+        }
+
+      } else
+        word += q[i++];
+    }
+
+    if (!quoted && !t.negated && t.key.isEmpty()
+        && (word == "OU" || word == "OR")) {
+      pendingOr = true;
+      continue;
+    }
+
+    if (word.isEmpty() && !quoted) {
+      if (!t.key.isEmpty())
+        return fail(error, "Valeur manquante pour '" + t.key + "'");
+      continue;
+    }
+
+    t.value = word;
+    if (pendingOr && !clauses.empty())
+      clauses.last().append(t);
+    else
+      clauses.append({t});
+    pendingOr = false;
+  }
+  return true;
+}
+
+bool compare (int lhs, const QString &op, int rhs) {
+  if (op.isEmpty() || op == "=")  return lhs == rhs;
+  else if (op == "<")   return lhs < rhs;
+  else if (op == "<=")  return lhs <= rhs;
+  else if (op == ">")   return lhs > rhs;
+  else                  return lhs >= rhs;
+}
+
+/// Static values designated by a term, either by id or by (accent
+/// insensitive) prefix of their name, as flags indexed like the table.
+/// Ordering operators compare ids
+template <typename T>
+using StaticMatch = std::bitset<std::tuple_size_v<
+                      std::decay_t<decltype(T::database())>>>;
+
+template <typename T>
+StaticMatch<T> matchStatic (const Term &t) {
+  bool numeric;
+  int pivot = t.value.toInt(&numeric);
+  if (!numeric) {
+    pivot = ID::INVALID;
+    const QString v = normalized(t.value);
+    for (const T &d: T::database()) {
+      if (normalized(d.text).startsWith(v)) {
+        pivot = d.id;
+        break;
+      }
+    }
+  }
+
+  StaticMatch<T> matches;
+  if (pivot == ID::INVALID) return matches;
+  for (const T &d: T::database())
+    matches[d.index()] = compare(d.id, t.op, pivot);
+  return matches;
+}
+
+template <typename T>
+bool staticTest (const T* Recipe::*field, const Term &t,
+                 Predicate::Test &test, QString *error) {
+  const StaticMatch<T> matches = matchStatic<T>(t);
+  if (matches.none()) return fail(error, "Valeur inconnue: " + t.toString());
+  test = [field, matches] (const Recipe &r) {
+    return matches[(r.*field)->index()];
+  };
+  return true;
+}
+
+bool makeTest (const Term &t, Predicate::Test &test, double &cost,
+               QString *error) {
+  const QString &k = t.key;
+  const QString v = t.value;
+  cost = QueryPlan::CheapCost;
+
+  if (k.isEmpty() || k == "titre" || k == "title") {
+    cost = QueryPlan::TextCost;
+    test = [v] (const Recipe &r) {
+      return r.title.contains(v, Qt::CaseInsensitive);
+    };
+
+  } else if (k == "ing" || k == "ingredient") {
+    // Resolved once through the ingredients index
+    Book &book = Book::current();
+    QSet<ID> recipes;
+    for (const auto &p: book.ingredients)
+      if (p.second.text.contains(v, Qt::CaseInsensitive))
+        for (const Recipe *r: book.pantry.users(p.first, false))
+          recipes.insert(r->id);
+    test = [recipes] (const Recipe &r) { return recipes.contains(r.id); };
+
+  } else if (k == "qualif") {
+    cost = QueryPlan::ListCost;
+    const quint64 trigrams = IngredientSignature::trigramBits(v);
+    test = [v, trigrams] (const Recipe &r) {
+      if ((r.signature.qualifiers & trigrams) != trigrams)  return false;
+      for (const auto &e: r.ingredients)
+        if (e->etype == EntryType::Ingredient
+            && static_cast<const IngredientEntry&>(*e).qualif
+                .contains(v, Qt::CaseInsensitive))
+          return true;
+      return false;
+    };
+
+  } else if (k == "groupe" || k == "group") {
+    cost = QueryPlan::ListCost;
+    const QString nv = normalized(v);
+    test = [nv] (const Recipe &r) {
+      for (const auto &e: r.ingredients)
+        if (e->etype == EntryType::Ingredient
+            && normalized(static_cast<const IngredientEntry&>(*e).group())
+                .startsWith(nv))
+          return true;
+      return false;
+    };
+
+  } else if (k == "sous" || k == "sub" || k == "recette") {
+    cost = QueryPlan::ListCost;
+    test = [v] (const Recipe &r) {
+      for (const auto &e: r.ingredients)
+        if (e->etype == EntryType::SubRecipe
+            && static_cast<const SubRecipeEntry&>(*e).recipe->title
+                .contains(v, Qt::CaseInsensitive))
+          return true;
+      return false;
+    };
+
+  } else if (k == "basique" || k == "basic") {
+    const QString nv = normalized(v);
+    bool b = (nv == "oui" || nv == "yes" || nv == "1" || nv == "true");
+    if (!b && nv != "non" && nv != "no" && nv != "0" && nv != "false")
+      return fail(error, "Valeur booléenne attendue: " + t.toString());
+    test = [b] (const Recipe &r) { return r.basic == b; };
+
+  } else if (k == "regime") {
+    return staticTest(&Recipe::regimen, t, test, error);
+
+  } else if (k == "type") {
+    return staticTest(&Recipe::type, t, test, error);
+
+  } else if (k == "duree") {
+    return staticTest(&Recipe::duration, t, test, error);
+
+  } else if (k == "statut" || k == "status") {
+    return staticTest(&Recipe::status, t, test, error);
+
+  } else if (k == "oubli" || k == "forgotten") {
+    bool ok;
+    int months = v.toInt(&ok);
+    if (!ok || months < 0)
+      return fail(error, "Nombre de mois attendu: " + t.toString());
+    auto forgottenSince = Book::current().history.forgottenSince(months);
+    test = [forgottenSince] (const Recipe &r) { return forgottenSince(r.id); };
+
+  } else if (k == "cuisine" || k == "cooked") {
+    bool ok;
+    int n = v.toInt(&ok);
+    if (!ok)  return fail(error, "Nombre attendu: " + t.toString());
+    const QString op = t.op;
+    const PlanningHistory::Counts counts = Book::current().history.counts();
+    test = [counts, op, n] (const Recipe &r) {
+      auto it = counts.find(r.id);
+      return compare(it != counts.end() ? it->second : 0, op, n);
+    };
+
+  } else
+    return fail(error, "Clé inconnue: " + k);
+
+  return true;
+}
+
+} // end of anonymous namespace
+
+static constexpr quint64 SamplingPeriod = 16;
+static constexpr quint64 ReorderPeriod = 256;
+
+/// Statistics kept for previous criteria (e.g. every prefix of a title)
+static constexpr size_t HistorySize = 64;
+
+double Predicate::expectedCost(void) const {
+  if (stats.sampled == 0) return cost;
+  return double(stats.nsecs) / stats.sampled;
+}
+
+void QueryPlan::clear(void) {
+  if (_history.size() + _predicates.size() > HistorySize) _history.clear();
+  for (const Predicate &p: _predicates) _history[p.key] = p.stats;
+  _predicates.clear();
+  _evaluations = 0;
+}
+
+void QueryPlan::add(const QString &key, double cost, Predicate::Test test) {
+  Predicate p { key, test, cost, {} };
+  auto it = _history.find(key);
+  if (it != _history.end()) p.stats = it->second;
+  _predicates.push_back(p);
+  reorder();
+}
+
+bool QueryPlan::parse(const QString &query, QString *error) {
+  QList<Alternatives> clauses;
+  if (!tokenize(query, clauses, error)) return false;
+
+  struct Compiled {
+    QString key;
+    double cost;
+    Predicate::Test test;
+  };
+  std::vector<Compiled> compiled;
+  for (const Alternatives &alternatives: clauses) {
+    Compiled c { "", 0, {} };
+    std::vector<Predicate::Test> tests;
+    for (const Term &t: alternatives) {
+      Predicate::Test test;
+      double cost;
+      if (!makeTest(t, test, cost, error))  return false;
+      if (t.negated)
+        test = [test] (const Recipe &r) { return !test(r); };
+      tests.push_back(test);
+      c.cost += cost;
+      if (!c.key.isEmpty()) c.key += "|";
+      c.key += t.toString();
+    }
+
+    if (tests.size() == 1)
+      c.test = tests.front();
+    else
+      c.test = [tests] (const Recipe &r) {
+        return std::any_of(tests.begin(), tests.end(),
+                           [&r] (const Predicate::Test &t) { return t(r); });
+      };
+    compiled.push_back(c);
+  }
+
+  for (const Compiled &c: compiled) add(c.key, c.cost, c.test);
+  return true;
+}
+
+bool QueryPlan::accepts(const Recipe &r) const {
+  if (++_evaluations % ReorderPeriod == 0)  reorder();
+
+  for (Predicate &p: _predicates) {
+    bool ok;
+    if (p.stats.evaluated % SamplingPeriod == 0) {
+      QElapsedTimer timer;
+      timer.start();
+      ok = p.test(r);
+      p.stats.nsecs += timer.nsecsElapsed();
+      p.stats.sampled++;
+    } else
+      ok = p.test(r);
+
+    p.stats.evaluated++;
+    if (!ok) {
+      p.stats.rejected++;
+      return false;
+    }
+  }
+  return true;
+}
+
+void QueryPlan::reorder(void) const {
+  std::stable_sort(_predicates.begin(), _predicates.end(),
+                   [] (const Predicate &lhs, const Predicate &rhs) {
+    return lhs.rank() < rhs.rank();
+  });
+}
+
+} // end of namespace db
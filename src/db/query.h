@@ -0,0 +1,79 @@
+#ifndef DB_QUERY_H
+#define DB_QUERY_H
+
+#include <functional>
+
+#include "recipe.h"
+
+namespace db {
+
+/// Lower case without diacritics
+QString normalized (const QString &s);
+
+struct PredicateStats {
+  quint64 evaluated = 0, rejected = 0;
+  quint64 sampled = 0;
+  qint64 nsecs = 0;
+
+  /// Probability of rejecting a recipe (with a uniform prior)
+  double rejectRate (void) const {
+    return (rejected + 1.) / (evaluated + 2.);
+  }
+};
+
+struct Predicate {
+  using Test = std::function<bool (const Recipe&)>;
+
+  QString key;  // Identifies the criterion *and* its value
+  Test test;
+  double cost;  // A priori cost estimate (in ns)
+  PredicateStats stats;
+
+  double expectedCost (void) const;
+
+  /// Expected cost spent per rejected recipe: lower should run first
+  double rank (void) const {
+    return expectedCost() / stats.rejectRate();
+  }
+};
+
+/// Conjunction of criteria evaluated cheapest-per-rejection first.
+/// Statistics are gathered while filtering and the order is periodically
+/// revised. They are kept across recompilations for criteria with the same
+/// key.
+class QueryPlan {
+public:
+  // Rough a priori costs
+  static constexpr double CheapCost = 5;
+  static constexpr double TextCost = 50;
+  static constexpr double ListCost = 500;
+
+  void clear (void);
+  void add (const QString &key, double cost, Predicate::Test test);
+
+  bool empty (void) const {
+    return _predicates.empty();
+  }
+
+  /// Parses a textual query and appends one predicate per clause.
+  /// Clauses are separated by spaces and all must hold; alternatives inside a
+  /// clause are separated by '|' (or OU/OR) and a leading '-' negates a term.
+  /// Terms are either (quoted) words searched in the title or key:value pairs
+  /// (e.g. ing:farine regime:vegan duree:<=journée "pâte brisée").
+  /// Nothing is added if the query is malformed.
+  bool parse (const QString &query, QString *error = nullptr);
+
+  bool accepts (const Recipe &r) const;
+
+private:
+  mutable std::vector<Predicate> _predicates;
+  mutable quint64 _evaluations = 0;
+
+  std::map<QString, PredicateStats> _history;
+
+  void reorder (void) const;
+};
+
+} // end of namespace db
+
+#endif // DB_QUERY_H
@@ -9,10 +9,38 @@
 
 namespace db {
 
+quint64 IngredientSignature::ingredientBit(ID id) {
+  // Fibonacci hashing onto 6 bits
+  return quint64(1) << ((quint32(id) * 2654435761u) >> 26);
+}
+
+quint64 IngredientSignature::trigramBits(const QString &text) {
+  const QString t = text.toLower();
+  quint64 bits = 0;
+  for (int i=0; i+3<=t.size(); i++) {
+    quint32 h = t[i].unicode();
+    h = h * 31 + t[i+1].unicode();
+    h = h * 31 + t[i+2].unicode();
+    bits |= quint64(1) << ((h * 2654435761u) >> 26);
+  }
+  return bits;
+}
+
+IngredientSignature IngredientSignature::query(const QString &ingredient,
+                                               const QString &qualifier) {
+  IngredientSignature s;
+  for (const auto &p: Book::current().ingredients)
+    if (p.second.text.contains(ingredient, Qt::CaseInsensitive))
+      s.ingredients |= ingredientBit(p.first);
+  s.qualifiers = trigramBits(qualifier);
+  return s;
+}
+
 Recipe::Recipe (void) {
   used = 0;
 
   title = "Poudre de pinrlinpinpin";
+  updateTitleKey();
 
   portions = 0;
   portionsLabel = "";
@@ -105,6 +133,35 @@ void Recipe::updateUsageCounts(void) {
   }
 }
 
+void Recipe::updateSignature(void) {
+  signature = IngredientSignature();
+  for (const auto &e: ingredients) {
+    if (e->etype != EntryType::Ingredient) continue;
+    const auto &i = static_cast<const IngredientEntry&>(*e);
+    signature.ingredients |= IngredientSignature::ingredientBit(i.idata->id);
+    signature.qualifiers |= IngredientSignature::trigramBits(i.qualif);
+  }
+}
+
+void Recipe::updateTitleKey(void) {
+  titleKey = collator().sortKey(title);
+}
+
+const QCollator& Recipe::collator(void) {
+  static const QCollator c = [] {
+    QCollator c (QLocale(QLocale::French));
+    c.setCaseSensitivity(Qt::CaseInsensitive);
+    c.setNumericMode(true);
+    return c;
+  }();
+  return c;
+}
+
+bool Recipe::titleLess(const Recipe &lhs, const Recipe &rhs) {
+  Q_ASSERT(lhs.titleKey && rhs.titleKey);
+  return lhs.titleKey->compare(*rhs.titleKey) < 0;
+}
+
 QIcon Recipe::basicIcon(void) const {
   return basic ? MiscIcons::basic_recipe() : QIcon();
 }
@@ -118,10 +175,19 @@ QStringList Recipe::ingredientList(double r) const {
   l.append("Pour " + QString::number(r * portions) + " " + portionsLabel + ":");
   for (const auto &e: ingredients)
     l.append(e->data(Qt::DisplayRole, r).toString());
-  qDebug() << l;
   return l;
 }
 
+const QString& Recipe::ingredientSummary(double r) const {
+  auto it = summaries.find(r);
+  if (it != summaries.end())  return it->second;
+
+  // Only a handful of ratios are expected (portions spin box)
+  static constexpr size_t MAX_CACHED = 16;
+  if (summaries.size() >= MAX_CACHED) summaries.clear();
+  return summaries[r] = ingredientList(r).join("\n");
+}
+
 Recipe Recipe::fromJson(const QJsonValue &j) {
   const QJsonObject jo = j.toObject();
   Recipe r;
@@ -130,6 +196,7 @@ Recipe Recipe::fromJson(const QJsonValue &j) {
   r.used = jo["used"].toInt();
 
   r.title = jo["title"].toString();
+  r.updateTitleKey();
 
   r.regimen = &at<RegimenData>(db::ID(jo["regimen"].toInt()));
   r.status = &at<StatusData>(db::ID(jo["status"].toInt()));
@@ -142,6 +209,7 @@ Recipe Recipe::fromJson(const QJsonValue &j) {
 
   for (const auto &i: jo["ing"].toArray())
     r.ingredients.append(IngredientEntry::fromJson(i));
+  r.updateSignature();
 
   for (const auto &s: jo["steps"].toArray())  r.steps.append(s.toString());
 
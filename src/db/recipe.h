@@ -1,13 +1,36 @@
 #ifndef DB_RECIPE_H
 #define DB_RECIPE_H
 
+#include <map>
+#include <optional>
+
 #include <QList>
 #include <QTime>
+#include <QCollator>
 
 #include "ingredientlistentries.h"
 
 namespace db {
 
+/// Bloom-like summary of a recipe's (direct) ingredients: one bit per hashed
+/// ingredient ID and one bit per hashed trigram of the qualifiers.
+/// A recipe whose signature does not cover a query cannot match it.
+struct IngredientSignature {
+  quint64 ingredients = 0, qualifiers = 0;
+
+  static quint64 ingredientBit (ID id);
+  static quint64 trigramBits (const QString &text);
+
+  /// Signature required by a search on ingredient and qualifier substrings
+  static IngredientSignature query (const QString &ingredient,
+                                    const QString &qualifier);
+
+  bool mayMatch (const IngredientSignature &query) const {
+    return (ingredients & query.ingredients)
+        && (qualifiers & query.qualifiers) == query.qualifiers;
+  }
+};
+
 struct Recipe {
   using ID = db::ID;
   using Database = cb_container<Recipe>;
@@ -18,6 +41,7 @@ struct Recipe {
   int used;
 
   QString title;
+  std::optional<QCollatorSortKey> titleKey;
 
   double portions;
   QString portionsLabel;
@@ -34,6 +58,8 @@ struct Recipe {
   QStringList steps;
   QString notes;
 
+  IngredientSignature signature;
+
   Recipe (void);
 
   QIcon basicIcon (void) const;
@@ -41,6 +67,22 @@ struct Recipe {
 
   QStringList ingredientList (double r) const;
 
+  /// ingredientList(r) as a single text, cached until clearSummaries()
+  const QString& ingredientSummary (double r) const;
+  void clearSummaries (void) const {
+    summaries.clear();
+  }
+  mutable std::map<double, QString> summaries;
+
+  // Must be called whenever the title is modified
+  void updateTitleKey (void);
+
+  // Must be called whenever the ingredients are modified
+  void updateSignature (void);
+
+  static const QCollator& collator (void);
+  static bool titleLess (const Recipe &lhs, const Recipe &rhs);
+
   // On update
   void updateUsageCounts (const IngredientList &newList);
 
@@ -1,8 +1,7 @@
 #include <QJsonArray>
 #include <QPainter>
 #include <QSettings>
-#include <QApplication>
-#include <QStyle>
+#include <QRegularExpression>
 
 #include "recipedata.h"
 #include "unitsmodel.h"
@@ -51,6 +50,15 @@ QPixmap circularIconFromColor (const QColor &d) {
   return p;
 }
 
+QIcon DecorationSource::icon (void) const {
+  switch (shape) {
+  case FILE:      return iconFromFile(file);
+  case RECTANGLE: return rectangularIconFromColor(QColor::fromRgb(color));
+  case CIRCLE:    return circularIconFromColor(QColor::fromRgb(color));
+  default:        return QIcon();
+  }
+}
+
 const QIcon& MiscIcons::sub_recipe (void) {
   static const auto i = iconFromFile(":/icons/sub-recipe.png");
   return i;
@@ -60,67 +68,83 @@ const QIcon& MiscIcons::basic_recipe (void) {
   return i;
 }
 
-#define ENTRY(I, N, R, G, B) \
-{ ID(I), { ID(I), N, rectangularIconFromColor(QColor::fromRgb(R,G,B)) } }
-template <>
-AlimentaryGroupData::Database AlimentaryGroupData::loadDatabase(void) {
-  return AlimentaryGroupData::Database {
-    ENTRY( 1, "Protéines", 255,   0,   0),
-    ENTRY( 2,   "Verdure",   0, 255,   0),
-    ENTRY( 3,  "Céréales", 255, 165,   0),
-    ENTRY( 4,    "Sucres", 255, 105, 180),
-    ENTRY( 5,    "Épices",   0, 128,   0),
-    ENTRY( 6,  "Liquides", 255,   0, 190),
-    ENTRY( 7,   "Graines", 160,  82,  42),
-    ENTRY( 8,  "Laitiers", 255, 248, 220),
-    ENTRY( 9,   "Lipides", 255, 215,   0),
-    ENTRY(10,   "Alcools",  64, 224, 208)
-  };
-}
-#undef ENTRY
-
-#define ENTRY(I, C) { ID(I), { ID(I), "", circularIconFromColor(C) } }
-template <>
-StatusData::Database StatusData::loadDatabase (void) {
-  return StatusData::Database {
-    ENTRY(1, QColor(Qt::red)   ),
-    ENTRY(2, QColor("#ffb000") ),
-    ENTRY(3, QColor(Qt::green) )
-  };
-}
-#undef ENTRY
-
-#define ENTRY(I, N, F) { ID(I), { ID(I), N, iconFromFile(F) } }
-template <>
-RegimenData::Database RegimenData::loadDatabase (void) {
-  return RegimenData::Database {
-    ENTRY(1, "Protéiné",   ":/icons/regimen-protein.png"    ),
-    ENTRY(2, "Végétarien", ":/icons/regimen-vegetarian.png" ),
-    ENTRY(3, "Vegan",      ":/icons/regimen-vegan.png"      )
-  };
-}
-
-template <>
-DishTypeData::Database DishTypeData::loadDatabase (void) {
-  return DishTypeData::Database {
-    ENTRY(1, "Neutre", ":/icons/type-neutral.png"  ),
-    ENTRY(2, "Salé",   ":/icons/type-salted.png"   ),
-    ENTRY(3, "Sucré",  ":/icons/type-sugar.ico"    ),
-  };
-}
+const QString IngredientData::NoUnit = "Ø";
 
-template <>
-DurationData::Database DurationData::loadDatabase (void) {
-  return DurationData::Database {
-    ENTRY(1, "Rapide",    ":/icons/time-short-2.png"    ),
-    ENTRY(2, "Journée",   ":/icons/time-medium-2.png"   ),
-    ENTRY(3, "Lendemain", ":/icons/time-long.png"       ),
-    ENTRY(4, "Très long", ":/icons/time-very-long.png"  ),
-  };
+namespace {
+
+struct KnownUnit {
+  const char *spelling, *symbol;
+  Dimension dimension;
+  double factor;
+};
+
+constexpr KnownUnit knownUnits [] {
+  { "Ø",                "Ø",    Dimension::Count,     1 },
+  { "pièce",            "Ø",    Dimension::Count,     1 },
+  { "unité",            "Ø",    Dimension::Count,     1 },
+  { "douzaine",         "douzaine", Dimension::Count, 12 },
+
+  { "mg",               "mg",   Dimension::Mass,   .001 },
+  { "milligramme",      "mg",   Dimension::Mass,   .001 },
+  { "g",                "g",    Dimension::Mass,      1 },
+  { "gr",               "g",    Dimension::Mass,      1 },
+  { "gramme",           "g",    Dimension::Mass,      1 },
+  { "kg",               "kg",   Dimension::Mass,   1000 },
+  { "kilo",             "kg",   Dimension::Mass,   1000 },
+  { "kilogramme",       "kg",   Dimension::Mass,   1000 },
+  { "livre",            "livre", Dimension::Mass,   500 },
+
+  { "ml",               "ml",   Dimension::Volume,    1 },
+  { "millilitre",       "ml",   Dimension::Volume,    1 },
+  { "cl",               "cl",   Dimension::Volume,   10 },
+  { "centilitre",       "cl",   Dimension::Volume,   10 },
+  { "dl",               "dl",   Dimension::Volume,  100 },
+  { "décilitre",        "dl",   Dimension::Volume,  100 },
+  { "l",                "l",    Dimension::Volume, 1000 },
+  { "litre",            "l",    Dimension::Volume, 1000 },
+  { "cuillère à café",  "cc",   Dimension::Volume,    5 },
+  { "c. à c.",          "cc",   Dimension::Volume,    5 },
+  { "cc",               "cc",   Dimension::Volume,    5 },
+  { "càc",              "cc",   Dimension::Volume,    5 },
+  { "cuillère à soupe", "cs",   Dimension::Volume,   15 },
+  { "c. à s.",          "cs",   Dimension::Volume,   15 },
+  { "cs",               "cs",   Dimension::Volume,   15 },
+  { "càs",              "cs",   Dimension::Volume,   15 },
+  { "tasse",            "tasse", Dimension::Volume, 250 },
+  { "verre",            "verre", Dimension::Volume, 200 },
+};
+
+/// Lower case, no accents, no punctuation and no plural mark
+QString normalizedUnit (const QString &text) {
+  QString n;
+  for (const QString &word:
+       text.normalized(QString::NormalizationForm_D).toLower()
+           .split(QRegularExpression("[\\s.]+"), Qt::SkipEmptyParts)) {
+    QString w;
+    for (QChar c: word)
+      if (c.category() != QChar::Mark_NonSpacing)  w += c;
+    if (w.size() > 2 && w.endsWith('s')) w.chop(1);
+    n += w;
+  }
+  return n;
+}
+
+} // end of anonymous namespace
+
+void UnitData::updateConversion(void) {
+  const QString n = normalizedUnit(text);
+  for (const KnownUnit &u: knownUnits) {
+    if (n == normalizedUnit(u.spelling)) {
+      dimension = u.dimension;
+      factor = u.factor;
+      symbol = u.symbol;
+      return;
+    }
+  }
+  dimension = Dimension::None;
+  factor = 1;
+  symbol.clear();
 }
-#undef ENTRY
-
-const QString IngredientData::NoUnit = "Ø";
 
 QJsonArray UnitData::toJson (const UnitData &d) {
   QJsonArray j;
@@ -137,6 +161,7 @@ UnitData UnitData::fromJson (QJsonArray j) {
   d.id = ID(j.takeAt(0).toInt());
   d.text = j.takeAt(0).toString();
   d.used = j.takeAt(0).toInt();
+  d.updateConversion();
   return d;
 }
 
@@ -2,10 +2,13 @@
 #define INGREDIENTDATA_H
 
 #include <set>
-#include <sstream>
+#include <array>
+#include <string>
+#include <optional>
 
 #include <QString>
 #include <QColor>
+#include <QIcon>
 #include <QStandardItemModel>
 
 namespace db {
@@ -42,24 +45,19 @@ struct TransparentID_CMP {
 template <typename T>
 using cb_container = std::map<ID, T>;
 
+/// Entry of a static table (e.g. at<RegimenData>(id)). Invalid ids are
+/// rejected at compile time in constant expressions, by an exception otherwise
 template <typename T>
-const T& at (const cb_container<T> &map, ID id) {
-  if (id <= 0)
-    throw std::invalid_argument("ID <= 0 is not a valid key!");
-  auto it = map.find(id);
-  if (it == map.end()) {
-    std::ostringstream oss;
-    oss << "Key " << int(id) << " was not found in the database";
-    throw std::invalid_argument(oss.str());
-  }
-  return it->second;
+constexpr const T& at (ID id) {
+  const auto &table = T::database();
+  if (id <= 0 || table.size() < std::size_t(id))
+    throw std::invalid_argument("Key " + std::to_string(int(id))
+                                + " was not found in the database");
+  return table[id-1];
 }
 
 template <typename T>
-const T& at (ID id) {  return at(T::database(), id);  }
-
-template <typename T>
-const T& first (void) { return T::database().begin()->second; }
+constexpr const T& first (void) { return T::database().front(); }
 
 namespace _details { // (private)
 
@@ -67,20 +65,21 @@ template <typename T, typename = int>
 struct HasDecoration : std::false_type {};
 
 template <typename T>
-struct HasDecoration <T, decltype((void) T::decoration, 0)> : std::true_type {};
+struct HasDecoration <T, decltype((void) std::declval<T>().decoration(), 0)>
+  : std::true_type {};
 
 } // end of namespace _details (private)
 
 struct BasicModel : public QStandardItemModel {
-  template <typename T>
-  BasicModel (const cb_container<T> &database) {
-    for (const auto &p: database)  appendRow(buildItemWithID(p.second));
+  template <typename Table>
+  BasicModel (const Table &database) {
+    for (const auto &v: database)  appendRow(buildItemWithID(v));
   }
 
 private:
   template <typename T>
   QStandardItem* buildItemWithID (const T &v) {
-    QStandardItem *item = new QStandardItem(v.decoration, v.text);
+    QStandardItem *item = new QStandardItem(v.decoration(), v.text);
     item->setData(v.id, IDRole);
     return item;
   }
@@ -97,15 +96,37 @@ struct MiscIcons {
   static const QIcon& basic_recipe (void);
 };
 
+/// Physical quantity measured by a unit
+enum class Dimension : int { None = 0, Mass, Volume, Count };
+
 struct UnitData {
   using ID = db::ID;
   ID id;
   QString text;
   int used;
 
-  UnitData (ID i, const QString &t) : id(i), text(t), used(0) {}
+  /// Derived from the text for known units (see updateConversion)
+  Dimension dimension;
+  double factor;  ///< To the base unit of the dimension (g, ml, piece)
+  QString symbol; ///< Canonical spelling, empty for unknown units
+
+  UnitData (ID i, const QString &t) : id(i), text(t), used(0) {
+    updateConversion();
+  }
   UnitData (void) : UnitData(ID::INVALID, "Invalid unit") {}
 
+  /// Must be called whenever the text is modified
+  void updateConversion (void);
+
+  /// Units sharing a key are the same (e.g. "g", "gramme", "grammes")
+  QString key (void) const {
+    return symbol.isEmpty() ? text : symbol;
+  }
+
+  bool convertibleTo (const UnitData &that) const {
+    return dimension != Dimension::None && dimension == that.dimension;
+  }
+
   static QJsonArray toJson (const UnitData &d);
   static UnitData fromJson (QJsonArray j);
 
@@ -117,37 +138,143 @@ enum class StaticDataType : int {
   AlimentaryGroup, Regimen, DishType, Duration, Status
 };
 
+/// How the icon of a static data is drawn. Only a description: pixmaps need
+/// a gui application and are built on first display
+struct DecorationSource {
+  enum Shape { NONE, FILE, RECTANGLE, CIRCLE };
+  Shape shape = NONE;
+  const char *file = nullptr;
+  QRgb color = 0;
+
+  static constexpr DecorationSource fromFile (const char *f) {
+    return { FILE, f, 0 };
+  }
+  static constexpr DecorationSource rectangle (QRgb c) {
+    return { RECTANGLE, nullptr, c };
+  }
+  static constexpr DecorationSource circle (QRgb c) {
+    return { CIRCLE, nullptr, c };
+  }
+
+  QIcon icon (void) const;
+};
+
+template <StaticDataType T>
+struct StaticTable;
+
+/// Fixed sets of values, stored in constant tables indexed by id (from 1)
 template <StaticDataType T>
 struct StaticData {
   static constexpr auto TYPE = T;
   using ID = db::ID;
   ID id = ID::INVALID;
-  QString text = "N/A";
-  QIcon decoration;
-
-  StaticData (ID i, const QString &t, const QIcon &d)
-    : id(i), text(t), decoration(d) {}
-  StaticData (void)
-    : StaticData(ID::INVALID, "Invalid data", QIcon()) {}
+  const char *text = "N/A";   // utf-8
+  DecorationSource source;
 
-  using Database = cb_container<StaticData<T>>;
-  static const Database& database (void) {
-    static const Database db = loadDatabase();
-    return db;
+  constexpr std::size_t index (void) const {
+    return std::size_t(id) - 1;
   }
 
-private:
-  static Database loadDatabase (void);
+  /// Built when first needed (from the gui thread)
+  const QIcon& decoration (void) const;
+
+  static constexpr const auto& database (void) {
+    return StaticTable<T>::data;
+  }
 };
 
 using AlimentaryGroupData = StaticData<StaticDataType::AlimentaryGroup>;
-using AlimentaryGroupsDatabase = AlimentaryGroupData::Database;
-
 using RegimenData = StaticData<StaticDataType::Regimen>;
 using DishTypeData = StaticData<StaticDataType::DishType>;
 using DurationData = StaticData<StaticDataType::Duration>;
 using StatusData = StaticData<StaticDataType::Status>;
 
+#define ENTRY(I, N, R, G, B) \
+  { ID(I), N, DecorationSource::rectangle(qRgb(R, G, B)) }
+template <>
+struct StaticTable<StaticDataType::AlimentaryGroup> {
+  static constexpr std::array<AlimentaryGroupData, 10> data {{
+    ENTRY( 1, "Protéines", 255,   0,   0),
+    ENTRY( 2,   "Verdure",   0, 255,   0),
+    ENTRY( 3,  "Céréales", 255, 165,   0),
+    ENTRY( 4,    "Sucres", 255, 105, 180),
+    ENTRY( 5,    "Épices",   0, 128,   0),
+    ENTRY( 6,  "Liquides", 255,   0, 190),
+    ENTRY( 7,   "Graines", 160,  82,  42),
+    ENTRY( 8,  "Laitiers", 255, 248, 220),
+    ENTRY( 9,   "Lipides", 255, 215,   0),
+    ENTRY(10,   "Alcools",  64, 224, 208)
+  }};
+};
+#undef ENTRY
+
+#define ENTRY(I, R, G, B) \
+  { ID(I), "", DecorationSource::circle(qRgb(R, G, B)) }
+template <>
+struct StaticTable<StaticDataType::Status> {
+  static constexpr std::array<StatusData, 3> data {{
+    ENTRY(1, 255,   0, 0),
+    ENTRY(2, 255, 176, 0),
+    ENTRY(3,   0, 255, 0)
+  }};
+};
+#undef ENTRY
+
+#define ENTRY(I, N, F) { ID(I), N, DecorationSource::fromFile(F) }
+template <>
+struct StaticTable<StaticDataType::Regimen> {
+  static constexpr std::array<RegimenData, 3> data {{
+    ENTRY(1, "Protéiné",   ":/icons/regimen-protein.png"    ),
+    ENTRY(2, "Végétarien", ":/icons/regimen-vegetarian.png" ),
+    ENTRY(3, "Vegan",      ":/icons/regimen-vegan.png"      )
+  }};
+};
+
+template <>
+struct StaticTable<StaticDataType::DishType> {
+  static constexpr std::array<DishTypeData, 3> data {{
+    ENTRY(1, "Neutre", ":/icons/type-neutral.png"  ),
+    ENTRY(2, "Salé",   ":/icons/type-salted.png"   ),
+    ENTRY(3, "Sucré",  ":/icons/type-sugar.ico"    )
+  }};
+};
+
+template <>
+struct StaticTable<StaticDataType::Duration> {
+  static constexpr std::array<DurationData, 4> data {{
+    ENTRY(1, "Rapide",    ":/icons/time-short-2.png"    ),
+    ENTRY(2, "Journée",   ":/icons/time-medium-2.png"   ),
+    ENTRY(3, "Lendemain", ":/icons/time-long.png"       ),
+    ENTRY(4, "Très long", ":/icons/time-very-long.png"  )
+  }};
+};
+#undef ENTRY
+
+namespace _details { // (private)
+
+template <typename T>
+constexpr bool indexedByID (void) {
+  for (std::size_t i=0; i<T::database().size(); i++)
+    if (T::database()[i].index() != i) return false;
+  return true;
+}
+
+static_assert(indexedByID<AlimentaryGroupData>());
+static_assert(indexedByID<StatusData>());
+static_assert(indexedByID<RegimenData>());
+static_assert(indexedByID<DishTypeData>());
+static_assert(indexedByID<DurationData>());
+
+} // end of namespace _details (private)
+
+template <StaticDataType T>
+const QIcon& StaticData<T>::decoration (void) const {
+  static std::array<std::optional<QIcon>, database().size()> icons;
+  auto &i = icons[index()];
+  if (!i) i = source.icon();
+  return *i;
+}
+
 struct IngredientData {
   using ID = db::ID;
   ID id = ID::INVALID;
@@ -0,0 +1,151 @@
+#include <algorithm>
+
+#include "recipegraph.h"
+
+#include <QDebug>
+
+namespace db {
+
+RecipeGraph::IDSet
+RecipeGraph::subrecipesOf(const Recipe::IngredientList &list) {
+  IDSet s;
+  for (const auto &e: list)
+    if (e->etype == EntryType::SubRecipe)
+      s.insert(static_cast<const SubRecipeEntry&>(*e).recipe->id);
+  return s;
+}
+
+bool RecipeGraph::update(const Recipe &r) {
+  IDSet subs = subrecipesOf(r.ingredients);
+  _nodes.insert(r.id);
+
+  auto &children = _children[r.id];
+  if (children == subs) return true;
+
+  for (ID c: children)  _parents[c].erase(r.id);
+  children.clear();
+  _orderValid = false;
+
+  bool ok = true;
+  for (ID c: subs) {
+    if (!cycle(r.id, c).empty()) {
+      qWarning("Ignoring subrecipe '%d' of '%s': it would create a cycle",
+               int(c), r.title.toStdString().c_str());
+      ok = false;
+      continue;
+    }
+    children.insert(c);
+    _parents[c].insert(r.id);
+    _nodes.insert(c);
+  }
+  return ok;
+}
+
+void RecipeGraph::remove(ID r) {
+  for (ID c: _children[r])  _parents[c].erase(r);
+  for (ID p: _parents[r])   _children[p].erase(r);
+  _children.erase(r);
+  _parents.erase(r);
+  _nodes.erase(r);
+  _orderValid = false;
+}
+
+void RecipeGraph::clear(void) {
+  _nodes.clear();
+  _children.clear();
+  _parents.clear();
+  _orderValid = false;
+}
+
+const RecipeGraph::IDSet& RecipeGraph::subrecipes(ID r) const {
+  static const IDSet none;
+  auto it = _children.find(r);
+  return it != _children.end() ? it->second : none;
+}
+
+const RecipeGraph::IDSet& RecipeGraph::users(ID r) const {
+  static const IDSet none;
+  auto it = _parents.find(r);
+  return it != _parents.end() ? it->second : none;
+}
+
+RecipeGraph::IDSet
+RecipeGraph::reachable(const std::map<ID, IDSet> &edges, ID r) {
+  IDSet seen;
+  IDs stack { r };
+  while (!stack.empty()) {
+    ID n = stack.back();
+    stack.pop_back();
+    auto it = edges.find(n);
+    if (it == edges.end())  continue;
+    for (ID m: it->second)
+      if (seen.insert(m).second)  stack.push_back(m);
+  }
+  return seen;
+}
+
+RecipeGraph::IDSet RecipeGraph::descendants(ID r) const {
+  return reachable(_children, r);
+}
+
+RecipeGraph::IDSet RecipeGraph::ancestors(ID r) const {
+  return reachable(_parents, r);
+}
+
+RecipeGraph::IDs RecipeGraph::cycle(ID parent, ID child) const {
+  if (parent == child)  return { child };
+
+  // Depth-first search for parent among the descendants of child
+  std::map<ID, ID> from { { child, INVALID } };
+  IDs stack { child };
+  while (!stack.empty()) {
+    ID n = stack.back();
+    stack.pop_back();
+    if (n == parent) {
+      IDs path;
+      for (ID i = parent; i != INVALID; i = from.at(i)) path.push_back(i);
+      std::reverse(path.begin(), path.end());
+      return path;
+    }
+    for (ID m: subrecipes(n))
+      if (from.emplace(m, n).second)  stack.push_back(m);
+  }
+  return {};
+}
+
+RecipeGraph::IDs RecipeGraph::cycle(ID r, const IDSet &subrecipes) const {
+  for (ID c: subrecipes) {
+    IDs path = cycle(r, c);
+    if (!path.empty())  return path;
+  }
+  return {};
+}
+
+const RecipeGraph::IDs& RecipeGraph::topologicalOrder(void) const {
+  if (_orderValid)  return _order;
+
+  // Kahn's algorithm on the reversed edges: leaves (no subrecipes) first
+  std::map<ID, size_t> pending;
+  IDs ready;
+  for (ID n: _nodes) {
+    size_t d = subrecipes(n).size();
+    if (d == 0) ready.push_back(n);
+    else        pending[n] = d;
+  }
+
+  _order.clear();
+  _order.reserve(_nodes.size());
+  while (!ready.empty()) {
+    ID n = ready.back();
+    ready.pop_back();
+    _order.push_back(n);
+    for (ID p: users(n))
+      if (--pending.at(p) == 0) ready.push_back(p);
+  }
+  Q_ASSERT(_order.size() == _nodes.size());
+
+  _orderValid = true;
+  return _order;
+}
+
+} // end of namespace db
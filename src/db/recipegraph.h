@@ -0,0 +1,60 @@
+#ifndef DB_RECIPEGRAPH_H
+#define DB_RECIPEGRAPH_H
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "recipe.h"
+
+namespace db {
+
+/// Recipe -> subrecipe dependencies, guaranteed acyclic.
+/// Edges closing a cycle are refused so that any recursive computation can
+/// instead walk the topological order (subrecipes before their users) once.
+class RecipeGraph {
+public:
+  using IDs = std::vector<ID>;
+  using IDSet = std::set<ID>;
+
+  /// Replaces the outgoing edges of r by its current subrecipes. Those that
+  /// would close a cycle are dropped with a warning, in which case returns
+  /// false
+  bool update (const Recipe &r);
+  void remove (ID r);
+  void clear (void);
+
+  const IDSet& subrecipes (ID r) const;
+  const IDSet& users (ID r) const;
+
+  /// Recipes reachable from r (r excluded)
+  IDSet descendants (ID r) const;
+
+  /// Recipes from which r is reachable (r excluded)
+  IDSet ancestors (ID r) const;
+
+  /// Path child -> ... -> parent if adding parent -> child would close a
+  /// cycle, empty otherwise
+  IDs cycle (ID parent, ID child) const;
+
+  /// First cycle that giving these subrecipes to r would create, if any
+  IDs cycle (ID r, const IDSet &subrecipes) const;
+
+  /// All recipes, subrecipes first
+  const IDs& topologicalOrder (void) const;
+
+  static IDSet subrecipesOf (const Recipe::IngredientList &list);
+
+private:
+  IDSet _nodes;
+  std::map<ID, IDSet> _children, _parents;
+
+  mutable bool _orderValid = false;
+  mutable IDs _order;
+
+  static IDSet reachable (const std::map<ID, IDSet> &edges, ID r);
+};
+
+} // end of namespace db
+
+#endif // DB_RECIPEGRAPH_H
@@ -18,6 +18,48 @@ QJsonArray fromByteArray(const QByteArray &barray) {
   return QCborValue::fromCbor(barray).toJsonValue().toArray();
 }
 
+QStringList RecipeMimeData::formats(void) const {
+  return QMimeData::formats() << Recipe::MimeType;
+}
+
+bool RecipeMimeData::hasFormat(const QString &mimetype) const {
+  return mimetype == Recipe::MimeType || QMimeData::hasFormat(mimetype);
+}
+
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+QVariant RecipeMimeData::retrieveData(const QString &mimetype,
+                                      QVariant::Type type) const {
+#else
+QVariant RecipeMimeData::retrieveData(const QString &mimetype,
+                                      QMetaType type) const {
+#endif
+  if (mimetype != Recipe::MimeType)
+    return QMimeData::retrieveData(mimetype, type);
+
+  QJsonArray jarray;
+  for (ID id: recipes)  jarray.append(id);
+  for (const QString &t: texts) jarray.append(t);
+  return toByteArray(jarray);
+}
+
+bool RecipeMimeData::read(const QMimeData *data,
+                          std::vector<ID> &recipes, QStringList &texts) {
+  if (auto d = qobject_cast<const RecipeMimeData*>(data)) {
+    recipes = d->recipes;
+    texts = d->texts;
+    return true;
+  }
+
+  if (!data->hasFormat(Recipe::MimeType)) return false;
+  for (const QJsonValue &v: fromByteArray(data->data(Recipe::MimeType))) {
+    if (v.isDouble()) recipes.push_back(ID(v.toInt()));
+    else              texts.append(v.toString());
+  }
+  return true;
+}
+
+// =============================================================================
+
 RecipesModel::RecipesModel(void) {}
 
 QModelIndex RecipesModel::addRecipe(Recipe &&r) {
@@ -34,6 +76,7 @@ QModelIndex RecipesModel::addRecipe(Recipe &&r) {
 
 void RecipesModel::delRecipe(Recipe *r) {
   valueModified(r->id);
+  _graph.remove(r->id);
   removeItem(r->id);
 }
 
@@ -69,10 +112,10 @@ QVariant RecipesModel::data (const QModelIndex &index, int role) const {
     switch (index.column()) {
     case 0:   return r.basicIcon();
     case 1:   return r.subrecipeIcon();
-    case 2:   return r.regimen->decoration;
-    case 3:   return r.type->decoration;
-    case 4:   return r.duration->decoration;
-    case 5:   return r.status->decoration;
+    case 2:   return r.regimen->decoration();
+    case 3:   return r.type->decoration();
+    case 4:   return r.duration->decoration();
+    case 5:   return r.status->decoration();
     default:  return QVariant();
     }
 
@@ -108,29 +151,32 @@ Qt::ItemFlags RecipesModel::flags(const QModelIndex &index) const {
 }
 
 QMimeData* RecipesModel::mimeData(const QModelIndexList &indexes) const {
-  QMimeData *d = base_t::mimeData(indexes);
+  RecipeMimeData *d = new RecipeMimeData;
   Q_ASSERT(indexes.size() == 1);
   d->setText(indexes.front().data().toString());
 
-  QSet<ID> ids;
+  std::set<ID> ids;
   for (const QModelIndex &i: indexes) ids.insert(ID(i.data(IDRole).toInt()));
-  QJsonArray jarray;
-  for (ID id: ids)  jarray.append(id);
-#ifndef NDEBUG
-  auto jarrayBA = toByteArray(jarray);
-  auto jarray2 = fromByteArray(jarrayBA);
-  Q_ASSERT(jarray == jarray2);
-#endif
-  qDebug() << "MimeData for " << indexes << " = " << jarray;
-  d->setData(Recipe::MimeType, toByteArray(jarray));
+  d->recipes.assign(ids.begin(), ids.end());
   return d;
 }
 
 void RecipesModel::valueModified(ID id) {
+  const Recipe &r = at(id);
+  _graph.update(r);
+
+  // Users display the title of their subrecipes
+  r.clearSummaries();
+  for (ID user: _graph.users(id)) at(user).clearSummaries();
+
   int index = indexOf(id);
   emit dataChanged(createIndex(index, 0), createIndex(index, columnCount()));
 }
 
+void RecipesModel::clearSummaries(void) {
+  for (const auto &p: _data)  p.second.clearSummaries();
+}
+
 void RecipesModel::fromJson(const QJsonArray &a) {
   for (const QJsonValue &v: a) {
     Recipe r = Recipe::fromJson(v);
@@ -143,10 +189,39 @@ void RecipesModel::fromJson(const QJsonArray &a) {
       if (i->etype == EntryType::SubRecipe)
         static_cast<SubRecipeEntry*>(i.data())->setRecipeFromHackedPointer();
 
+  _graph.clear();
+  for (const auto &p: _data)  _graph.update(p.second);
+
   nextID();
 }
 
-QJsonArray RecipesModel::toJson(void) {
+void RecipesModel::merge(const QJsonArray &a) {
+  if (a.isEmpty())  return;
+  beginResetModel();
+
+  std::vector<ID> ids;
+  for (const QJsonValue &v: a) {
+    Recipe r = Recipe::fromJson(v);
+    ids.push_back(r.id);
+    if (_nextID <= r.id)  _nextID = ID(int(r.id)+1);
+    _data.insert_or_assign(r.id, std::move(r));
+  }
+
+  for (ID id: ids)
+    for (auto &i: _data.at(id).ingredients)
+      if (i->etype == EntryType::SubRecipe)
+        static_cast<SubRecipeEntry*>(i.data())->setRecipeFromHackedPointer();
+
+  // Edges may have been reversed: checking them one recipe at a time could
+  // see transient cycles
+  _graph.clear();
+  for (const auto &p: _data)  _graph.update(p.second);
+  clearSummaries();
+
+  endResetModel();
+}
+
+QJsonArray RecipesModel::toJson(void) const {
   QJsonArray a;
   for (const auto &p: _data)
     a.append(Recipe::toJson(p.second));
@@ -1,14 +1,45 @@
 #ifndef RECIPESLISTMODEL_H
 #define RECIPESLISTMODEL_H
 
+#include <QMimeData>
+#include <QPersistentModelIndex>
+
 #include "basemodel.hpp"
 #include "recipe.h"
+#include "recipegraph.h"
 
 namespace db {
 
 QByteArray toByteArray (const QJsonArray &array);
 QJsonArray fromByteArray (const QByteArray &array);
 
+/// Drag and drop payload: recipe IDs and free texts. Drops inside the
+/// application read the lists directly, the CBOR encoding (see toByteArray)
+/// is only produced when requested from outside.
+class RecipeMimeData : public QMimeData {
+  Q_OBJECT
+public:
+  std::vector<ID> recipes;
+  QStringList texts;
+  QPersistentModelIndex source;
+
+  QStringList formats (void) const override;
+  bool hasFormat (const QString &mimetype) const override;
+
+  /// Payload of any mime data, decoded from CBOR if it comes from elsewhere
+  static bool read (const QMimeData *data,
+                    std::vector<ID> &recipes, QStringList &texts);
+
+protected:
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+  QVariant retrieveData (const QString &mimetype,
+                         QVariant::Type type) const override;
+#else
+  QVariant retrieveData (const QString &mimetype,
+                         QMetaType type) const override;
+#endif
+};
+
 class RecipesModel : public BaseModel<Recipe> {
 public:
   static constexpr auto SortRole = PtrRole+42;
@@ -34,8 +65,22 @@ public:
 
   void valueModified(ID id) override;
 
+  /// Drops all cached ingredient summaries (e.g. after renaming a unit)
+  void clearSummaries (void);
+
+  const RecipeGraph& graph (void) const {
+    return _graph;
+  }
+
   void fromJson (const QJsonArray &a);
-  QJsonArray toJson(void);
+  QJsonArray toJson(void) const;
+
+  /// Adds or replaces these recipes, keeping their ids. Their subrecipes may
+  /// be any recipe of the model once merged
+  void merge (const QJsonArray &a);
+
+private:
+  RecipeGraph _graph;
 };
 
 } // end of namespace db
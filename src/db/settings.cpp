@@ -20,6 +20,9 @@ const Settings::Data& Settings::data (Settings::Type type) {
     { Settings::MODAL_SETTINGS, { "Configuration",         true } },
 
     { Settings::PLANNING_WINDOW, { "Planning", 7 } },
+
+    { Settings::HTTP_SERVER, { "Serveur HTTP (lecture seule)", false } },
+    {   Settings::HTTP_PORT, { "Port",                         8080  } },
   };
 
   return sdata.at(type);
@@ -15,7 +15,9 @@ public:
 
     MODAL_IMANAGER, MODAL_REPAIRS, MODAL_SETTINGS,
 
-    PLANNING_WINDOW
+    PLANNING_WINDOW,
+
+    HTTP_SERVER, HTTP_PORT
   };
   Q_ENUM(Type)
 
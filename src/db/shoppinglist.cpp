@@ -0,0 +1,106 @@
+#include <QJsonArray>
+
+#include "shoppinglist.h"
+#include "settings.h"
+#include "book.h"
+
+#include <QDebug>
+
+namespace db {
+
+ShoppingList::ShoppingList (const PlanningModel &planning,
+                            const RecipesModel &recipes,
+                            Expansion &expansion)
+  : _planning(planning), _recipes(recipes), _expansion(expansion) {
+
+  connect(&planning, &QAbstractItemModel::dataChanged,
+          this, &ShoppingList::updateCells);
+
+  connect(&planning, &QAbstractItemModel::modelReset,
+          this, &ShoppingList::invalidate);
+  connect(&planning, &QAbstractItemModel::columnsInserted,
+          this, &ShoppingList::invalidate);
+  connect(&planning, &QAbstractItemModel::columnsRemoved,
+          this, &ShoppingList::invalidate);
+}
+
+void ShoppingList::setPortions(double p) {
+  if (_portions == p) return;
+  _portions = p;
+  invalidate();
+}
+
+const ShoppingList::Quantities& ShoppingList::total(void) {
+  if (!_valid || _today != QDate::currentDate())  rebuild();
+  return _total;
+}
+
+std::map<ID, ShoppingList::Quantities> ShoppingList::byGroup(void) {
+  std::map<ID, Quantities> groups;
+  for (const auto &p: total()) {
+    const IngredientData &i = Book::current().ingredients.at(p.first.first);
+    groups[i.group ? i.group->id : INVALID].insert(p);
+  }
+  return groups;
+}
+
+ShoppingList::Quantities ShoppingList::cell(const QModelIndex &index) {
+  Quantities q;
+
+  QDate date = _planning.date(index);
+  int window = Settings::value<int>(Settings::PLANNING_WINDOW);
+  if (!date.isValid() || date < _today || _today.addDays(window) <= date)
+    return q;
+
+  for (const QJsonValue &v: index.data(PlanningModel::JsonRole).value<QJsonArray>()) {
+    if (!v.isDouble())  continue; // Free text
+    const Recipe &r = _recipes.at(ID(v.toInt()));
+    double ratio = (_portions > 0 && r.portions > 0) ? _portions / r.portions
+                                                     : 1;
+    for (const auto &p: _expansion.of(r)) q[p.first] += ratio * p.second;
+  }
+  return q;
+}
+
+void ShoppingList::updateCells(const QModelIndex &topLeft,
+                               const QModelIndex &bottomRight) {
+  if (_valid) {
+    for (int i=topLeft.row(); i<=bottomRight.row(); i++) {
+      for (int j=topLeft.column(); j<=bottomRight.column(); j++) {
+        Quantities &contribution = _cells[{i, j}];
+        for (const auto &p: contribution) {
+          auto it = _total.find(p.first);
+          if (it == _total.end()) continue;
+          it->second -= p.second;
+          if (qFuzzyIsNull(it->second)) _total.erase(it);
+        }
+
+        contribution = cell(_planning.index(i, j));
+        for (const auto &p: contribution) _total[p.first] += p.second;
+      }
+    }
+  }
+  emit changed();
+}
+
+void ShoppingList::invalidate(void) {
+  _valid = false;
+  emit changed();
+}
+
+void ShoppingList::rebuild(void) {
+  _today = QDate::currentDate();
+  _cells.clear();
+  _total.clear();
+  for (int i=0; i<_planning.rowCount(); i++) {
+    for (int j=0; j<_planning.columnCount(); j++) {
+      Quantities q = cell(_planning.index(i, j));
+      if (q.empty())  continue;
+      for (const auto &p: q)  _total[p.first] += p.second;
+      _cells[{i, j}] = std::move(q);
+    }
+  }
+  _valid = true;
+}
+
+} // end of namespace db
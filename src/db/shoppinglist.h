@@ -0,0 +1,59 @@
+#ifndef DB_SHOPPINGLIST_H
+#define DB_SHOPPINGLIST_H
+
+#include "planningmodel.h"
+#include "expansion.h"
+
+namespace db {
+
+/// Quantities to buy for the recipes planned in the upcoming
+/// Settings::PLANNING_WINDOW days. Each planning cell contributes its own
+/// (subrecipes expanded) quantities to the total so that editing a cell only
+/// replaces that contribution. Structural changes of the planning trigger a
+/// lazy rebuild.
+class ShoppingList : public QObject {
+  Q_OBJECT
+public:
+  using Quantities = Expansion::Quantities;
+
+  ShoppingList (const PlanningModel &planning, const RecipesModel &recipes,
+                Expansion &expansion);
+
+  /// Portions per planned meal, 0 to use each recipe's own
+  double portions (void) const {
+    return _portions;
+  }
+  void setPortions (double p);
+
+  const Quantities& total (void);
+
+  /// Total split by alimentary group (INVALID for ungrouped ingredients)
+  std::map<ID, Quantities> byGroup (void);
+
+  /// Forces a rebuild on next read (e.g. after a recipe was modified)
+  void invalidate (void);
+
+signals:
+  void changed (void);
+
+private:
+  const PlanningModel &_planning;
+  const RecipesModel &_recipes;
+  Expansion &_expansion;
+
+  double _portions = 0;
+
+  bool _valid = false;
+  QDate _today;
+  std::map<std::pair<int, int>, Quantities> _cells;  // row, column
+  Quantities _total;
+
+  Quantities cell (const QModelIndex &index);
+  void updateCells (const QModelIndex &topLeft, const QModelIndex &bottomRight);
+
+  void rebuild (void);
+};
+
+} // end of namespace db
+
+#endif // DB_SHOPPINGLIST_H
@@ -0,0 +1,377 @@
+#include <stdexcept>
+
+#include <QCryptographicHash>
+#include <QCborArray>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QtEndian>
+
+#include "sync.h"
+
+#include <QDebug>
+
+namespace db {
+
+namespace {
+
+static constexpr int Version = 1;
+
+/// Whole categories may travel at once, but not whole disks
+static constexpr quint32 MaxMessage = 64 << 20;
+
+QCborValue field (const QCborMap &message, const char *key) {
+  return message.value(QLatin1String(key));
+}
+
+bool category (const QCborValue &v, SyncTree::Category &c) {
+  qint64 i = v.toInteger(-1);
+  if (i < 0 || SyncTree::CATEGORIES <= i) return false;
+  c = SyncTree::Category(i);
+  return true;
+}
+
+bool bucket (const QCborValue &v, int &b) {
+  qint64 i = v.toInteger(-1);
+  if (i < 0 || SyncTree::BUCKETS <= i)  return false;
+  b = int(i);
+  return true;
+}
+
+} // end of anonymous namespace
+
+// =============================================================================
+// Merkle tree
+// =============================================================================
+
+SyncTree::SyncTree(const QJsonObject &book) {
+  QCryptographicHash root (QCryptographicHash::Sha1);
+  for (int i=0; i<CATEGORIES; i++) {
+    Category c = Category(i);
+    Node &node = _categories[i];
+
+    QJsonValue value = book[name(c)];
+    QJsonArray records = (c == HISTORY) ? QJsonArray{value} : value.toArray();
+    for (const QJsonValue &r: records) {
+      QByteArray json = r.isObject()
+          ? QJsonDocument(r.toObject()).toJson(QJsonDocument::Compact)
+          : QJsonDocument(r.toArray()).toJson(QJsonDocument::Compact);
+      Key k = key(c, r);
+      node.buckets[bucket(k)].leaves[k] =
+        QCryptographicHash::hash(json, QCryptographicHash::Sha1);
+      node.records[k] = json;
+    }
+
+    QCryptographicHash category (QCryptographicHash::Sha1);
+    for (Bucket &b: node.buckets) {
+      QCryptographicHash h (QCryptographicHash::Sha1);
+      for (const auto &p: b.leaves) {
+        QByteArray k (sizeof(Key), 0);
+        qToBigEndian<Key>(p.first, k.data());
+        h.addData(k);
+        h.addData(p.second);
+      }
+      b.hash = h.result();
+      category.addData(b.hash);
+    }
+    node.hash = category.result();
+    root.addData(node.hash);
+  }
+  _root = root.result();
+}
+
+QByteArray SyncTree::record(Category c, Key k) const {
+  const auto &records = _categories[c].records;
+  auto it = records.find(k);
+  return it != records.end() ? it->second : QByteArray();
+}
+
+SyncTree::Key SyncTree::key(Category c, const QJsonValue &record) {
+  switch (c) {
+  case UNITS:
+  case INGREDIENTS:
+    return record.toArray().first().toInt();
+  case RECIPES:
+    return record.toObject()["id"].toInt();
+  case PLANNING:
+    return QDate::fromString(record.toArray().first().toString(),
+                             Qt::ISODate).toJulianDay();
+  case HISTORY:
+    break;
+  }
+  return 0;
+}
+
+QString SyncTree::name(Category c) {
+  static const std::array<QString, CATEGORIES> names {{
+    "units", "ingredients", "recipes", "planning", "history"
+  }};
+  return names[c];
+}
+
+// =============================================================================
+// Protocol
+// =============================================================================
+
+SyncSession::SyncSession(Book &book, Role role, QIODevice *device,
+                         QObject *parent)
+  : QObject(parent), _book(book), _role(role), _device(device),
+    _finished(false) {
+
+  connect(_device, &QIODevice::readyRead, this, &SyncSession::read);
+  connect(_device, &QIODevice::readChannelFinished, this, [this] {
+    read();
+    if (!_finished) finish(false, "Connexion interrompue");
+  });
+}
+
+void SyncSession::start(void) {
+  if (_role == SERVER) {
+    if (_device->bytesAvailable() > 0) read();
+    return;
+  }
+
+  _tree.reset(new SyncTree(_book.toJson()));
+  QCborArray hashes;
+  for (int c=0; c<SyncTree::CATEGORIES; c++)
+    hashes.append(_tree->hash(SyncTree::Category(c)));
+  send({{"t", "hello"}, {"v", Version}, {"root", _tree->root()},
+        {"hashes", hashes}});
+}
+
+void SyncSession::send(const QCborMap &message) {
+  QByteArray data = message.toCborValue().toCbor();
+  QByteArray header (sizeof(quint32), 0);
+  qToBigEndian<quint32>(quint32(data.size()), header.data());
+  _device->write(header);
+  _device->write(data);
+  _stats.sent += header.size() + data.size();
+}
+
+void SyncSession::read(void) {
+  _buffer += _device->readAll();
+  while (!_finished && _buffer.size() >= int(sizeof(quint32))) {
+    quint32 size = qFromBigEndian<quint32>(_buffer.constData());
+    if (size > MaxMessage)  return fail("Message trop long");
+    if (quint32(_buffer.size()) < sizeof(quint32) + size) break;
+
+    QByteArray data = _buffer.mid(sizeof(quint32), size);
+    _buffer.remove(0, sizeof(quint32) + size);
+    _stats.received += sizeof(quint32) + size;
+
+    QCborParserError error;
+    QCborValue message = QCborValue::fromCbor(data, &error);
+    if (error.error != QCborError::NoError || !message.isMap())
+      return fail("Message invalide");
+    handle(message.toMap());
+  }
+}
+
+void SyncSession::handle(const QCborMap &message) {
+  QString type = field(message, "t").toString();
+  if (type == "error")
+    finish(false, field(message, "error").toString());
+  else if (_role == SERVER)
+    serve(type, message);
+  else
+    fetch(type, message);
+}
+
+void SyncSession::serve(const QString &type, const QCborMap &message) {
+  if (type == "hello") {
+    if (field(message, "v").toInteger() != Version)
+      return fail("Version du protocole incompatible");
+
+    _tree.reset(new SyncTree(_book.toJson()));
+    if (field(message, "root").toByteArray() == _tree->root()) {
+      send({{"t", "done"}});
+      return finish(true, "Livres identiques");
+    }
+
+    QCborArray remote = field(message, "hashes").toArray();
+    if (remote.size() != SyncTree::CATEGORIES)
+      return fail("Message invalide");
+
+    QCborMap hashes;
+    for (int i=0; i<SyncTree::CATEGORIES; i++) {
+      SyncTree::Category c = SyncTree::Category(i);
+      if (remote.at(i).toByteArray() == _tree->hash(c)) continue;
+      QCborArray buckets;
+      for (int b=0; b<SyncTree::BUCKETS; b++) buckets.append(_tree->hash(c, b));
+      hashes.insert(i, buckets);
+    }
+    send({{"t", "buckets"}, {"root", _tree->root()}, {"hashes", hashes}});
+
+  } else if (!_tree) {
+    fail("Message inattendu: " + type);
+
+  } else if (type == "want") {
+    QCborMap wanted = field(message, "buckets").toMap(), leaves;
+    for (auto it = wanted.cbegin(); it != wanted.cend(); ++it) {
+      SyncTree::Category c;
+      if (!category(it.key(), c)) return fail("Catégorie inconnue");
+
+      QCborMap buckets;
+      for (const QCborValue &v: it.value().toArray()) {
+        int b;
+        if (!bucket(v, b))  return fail("Panier inconnu");
+        QCborArray l;
+        for (const auto &p: _tree->leaves(c, b))
+          l.append(QCborArray{p.first, p.second});
+        buckets.insert(b, l);
+      }
+      leaves.insert(int(c), buckets);
+    }
+    send({{"t", "leaves"}, {"leaves", leaves}});
+
+  } else if (type == "get") {
+    QCborMap keys = field(message, "keys").toMap(), records;
+    for (auto it = keys.cbegin(); it != keys.cend(); ++it) {
+      SyncTree::Category c;
+      if (!category(it.key(), c)) return fail("Catégorie inconnue");
+
+      QCborArray r;
+      for (const QCborValue &k: it.value().toArray()) {
+        QByteArray json = _tree->record(c, k.toInteger());
+        if (json.isEmpty()) return fail("Enregistrement inconnu");
+        r.append(json);
+      }
+      _stats.served += r.size();
+      records.insert(int(c), r);
+    }
+    send({{"t", "records"}, {"records", records}});
+
+  } else if (type == "bye") {
+    if (field(message, "ok").toBool())
+      finish(true, "Synchronisation terminée");
+    else
+      finish(false, "Échec de la vérification par le client");
+
+  } else
+    fail("Message inattendu: " + type);
+}
+
+void SyncSession::fetch(const QString &type, const QCborMap &message) {
+  if (type == "done") {
+    finish(true, "Livres identiques");
+
+  } else if (type == "buckets") {
+    _remoteRoot = field(message, "root").toByteArray();
+
+    QCborMap hashes = field(message, "hashes").toMap(), wanted;
+    for (auto it = hashes.cbegin(); it != hashes.cend(); ++it) {
+      SyncTree::Category c;
+      QCborArray remote = it.value().toArray();
+      if (!category(it.key(), c) || remote.size() != SyncTree::BUCKETS)
+        return fail("Message invalide");
+
+      QCborArray buckets;
+      for (int b=0; b<SyncTree::BUCKETS; b++)
+        if (remote.at(b).toByteArray() != _tree->hash(c, b))
+          buckets.append(b);
+      wanted.insert(int(c), buckets);
+    }
+    send({{"t", "want"}, {"buckets", wanted}});
+
+  } else if (type == "leaves") {
+    QCborMap leaves = field(message, "leaves").toMap(), wanted;
+    for (auto it = leaves.cbegin(); it != leaves.cend(); ++it) {
+      SyncTree::Category c;
+      if (!category(it.key(), c)) return fail("Catégorie inconnue");
+
+      QCborArray keys;
+      QJsonArray removed;
+      QCborMap buckets = it.value().toMap();
+      for (auto bit = buckets.cbegin(); bit != buckets.cend(); ++bit) {
+        int b;
+        if (!bucket(bit.key(), b))  return fail("Panier inconnu");
+
+        SyncTree::Leaves remote;
+        for (const QCborValue &v: bit.value().toArray())
+          remote[v[0].toInteger()] = v[1].toByteArray();
+
+        const SyncTree::Leaves &local = _tree->leaves(c, b);
+        for (const auto &p: remote) {
+          auto l = local.find(p.first);
+          if (l == local.end() || l->second != p.second)  keys.append(p.first);
+        }
+        for (const auto &p: local) {
+          if (remote.count(p.first))  continue;
+          if (c == SyncTree::PLANNING)
+            removed.append(QDate::fromJulianDay(p.first).toString(Qt::ISODate));
+          else
+            removed.append(int(p.first));
+        }
+      }
+
+      if (!keys.isEmpty())  wanted.insert(int(c), keys);
+      if (!removed.isEmpty()) _removed[SyncTree::name(c)] = removed;
+    }
+
+    if (wanted.isEmpty())
+      apply(QJsonObject());
+    else
+      send({{"t", "get"}, {"keys", wanted}});
+
+  } else if (type == "records") {
+    QJsonObject updated;
+    QCborMap records = field(message, "records").toMap();
+    for (auto it = records.cbegin(); it != records.cend(); ++it) {
+      SyncTree::Category c;
+      if (!category(it.key(), c)) return fail("Catégorie inconnue");
+
+      QJsonArray values;
+      for (const QCborValue &v: it.value().toArray()) {
+        QJsonDocument doc = QJsonDocument::fromJson(v.toByteArray());
+        if (doc.isNull()) return fail("Enregistrement invalide");
+        if (doc.isObject()) values.append(doc.object());
+        else                values.append(doc.array());
+      }
+      _stats.updated += values.size();
+
+      if (c == SyncTree::HISTORY) {
+        if (values.size() != 1) return fail("Historique invalide");
+        updated[SyncTree::name(c)] = values.first();
+      } else
+        updated[SyncTree::name(c)] = values;
+    }
+    apply(updated);
+
+  } else
+    fail("Message inattendu: " + type);
+}
+
+void SyncSession::apply(const QJsonObject &updated) {
+  // Checked before anything changes: the book stays as is if refused
+  QString error;
+  bool merged;
+  try {
+    merged = _book.merge(updated, _removed, &error);
+  } catch (const std::invalid_argument &e) {
+    merged = false;
+    error = e.what();
+  }
+  if (!merged)  return fail("Enregistrements refusés: " + error);
+  for (const QJsonValue &v: _removed) _stats.removed += v.toArray().size();
+
+  bool ok = (SyncTree(_book.toJson()).root() == _remoteRoot);
+  send({{"t", "bye"}, {"ok", ok}});
+  if (ok)
+    finish(true, "Synchronisation terminée");
+  else
+    finish(false, "Échec de la vérification");
+}
+
+void SyncSession::fail(const QString &error) {
+  qWarning() << "Synchronisation failed:" << error;
+  send({{"t", "error"}, {"error", error}});
+  finish(false, error);
+}
+
+void SyncSession::finish(bool ok, const QString &message) {
+  if (_finished)  return;
+  _finished = true;
+  disconnect(_device, nullptr, this, nullptr);
+  emit finished(ok, message);
+}
+
+} // end of namespace db
@@ -0,0 +1,144 @@
+#ifndef DB_SYNC_H
+#define DB_SYNC_H
+
+#include <array>
+#include <map>
+#include <memory>
+
+#include <QIODevice>
+#include <QCborMap>
+
+#include "book.h"
+
+namespace db {
+
+/// Content hashes of a book, as a three levels Merkle tree: every record (unit,
+/// ingredient, recipe, planning day and the history as a whole) is hashed,
+/// records are spread over a fixed number of buckets per category and each
+/// level hashes the one below. Two books agree on a subtree iff its hashes do.
+class SyncTree {
+public:
+  enum Category { UNITS, INGREDIENTS, RECIPES, PLANNING, HISTORY };
+  static constexpr int CATEGORIES = HISTORY+1;
+  static constexpr int BUCKETS = 64;
+
+  /// Identifier (units, ingredients, recipes), julian day (planning) or 0
+  using Key = qint64;
+  using Hash = QByteArray;
+  using Leaves = std::map<Key, Hash>;
+
+  SyncTree (const QJsonObject &book);
+
+  const Hash& root (void) const {
+    return _root;
+  }
+
+  const Hash& hash (Category c) const {
+    return _categories[c].hash;
+  }
+
+  const Hash& hash (Category c, int bucket) const {
+    return _categories[c].buckets[bucket].hash;
+  }
+
+  const Leaves& leaves (Category c, int bucket) const {
+    return _categories[c].buckets[bucket].leaves;
+  }
+
+  /// Compact json of a record, empty if unknown
+  QByteArray record (Category c, Key k) const;
+
+  static int bucket (Key k) {
+    return int(quint64(k) % BUCKETS);
+  }
+
+  static Key key (Category c, const QJsonValue &record);
+
+  /// As in Book::toJson
+  static QString name (Category c);
+
+private:
+  struct Bucket {
+    Hash hash;
+    Leaves leaves;
+  };
+  struct Node {
+    Hash hash;
+    std::array<Bucket, BUCKETS> buckets;
+    std::map<Key, QByteArray> records;
+  };
+  std::array<Node, CATEGORIES> _categories;
+  Hash _root;
+};
+
+/// One side of a synchronisation over any connected, sequential device (tcp
+/// or local socket, ...). The client's book becomes a copy of the server's
+/// while only the differing records travel:
+///  client: hello    root and category hashes
+///  server: done     nothing to do
+///       or buckets  bucket hashes of the differing categories
+///  client: want     differing buckets
+///  server: leaves   record hashes of these buckets
+///  client: get      missing or differing records
+///  server: records  their contents
+///  client: bye      once applied (and checked against the server root)
+/// Messages are length-prefixed cbor maps. Either side may answer an error.
+class SyncSession : public QObject {
+  Q_OBJECT
+public:
+  enum Role { SERVER, CLIENT };
+
+  static constexpr quint16 DefaultPort = 8091;
+
+  struct Stats {
+    int updated = 0, removed = 0;   // records changed locally (client)
+    int served = 0;                 // records sent (server)
+    qint64 sent = 0, received = 0;  // bytes
+  };
+
+  /// Does not take ownership of the device
+  SyncSession (Book &book, Role role, QIODevice *device,
+               QObject *parent = nullptr);
+
+  /// Clients speak first, servers only start listening to the device
+  void start (void);
+
+  const Stats& stats (void) const {
+    return _stats;
+  }
+
+  bool isFinished (void) const {
+    return _finished;
+  }
+
+signals:
+  void finished (bool ok, const QString &message);
+
+private:
+  Book &_book;
+  Role _role;
+  QIODevice *_device;
+  QByteArray _buffer;
+
+  std::unique_ptr<SyncTree> _tree;  // snapshot of the local book
+  SyncTree::Hash _remoteRoot;
+  QJsonObject _removed;
+
+  Stats _stats;
+  bool _finished;
+
+  void send (const QCborMap &message);
+  void read (void);
+  void handle (const QCborMap &message);
+
+  void serve (const QString &type, const QCborMap &message);
+  void fetch (const QString &type, const QCborMap &message);
+
+  void apply (const QJsonObject &updated);
+  void fail (const QString &error);
+  void finish (bool ok, const QString &message);
+};
+
+} // end of namespace db
+
+#endif // DB_SYNC_H
@@ -24,6 +24,7 @@ void UnitsModel::add (const QString &text) {
   insertRows(index, 1, QModelIndex());
   auto &item = atIndex(index);
   item.text = text;
+  item.updateConversion();
   item.used = 0;
   valueModified(item.id);
 }
@@ -31,9 +32,25 @@ void UnitsModel::add (const QString &text) {
 void UnitsModel::update(ID id, const QString &text) {
   auto &item = at(id);
   if (!text.isEmpty())  item.text = text;
+  item.updateConversion();
   valueModified(item.id);
 }
 
+const UnitData& UnitsModel::reference(const UnitData &u) const {
+  if (u.dimension == Dimension::None) return u;
+
+  // The (lowest ID) unit of factor 1, otherwise the one with the smallest
+  // factor, so that all units of the dimension agree
+  const UnitData *ref = nullptr;
+  for (const auto &p: _data) {
+    const UnitData &v = p.second;
+    if (v.dimension != u.dimension) continue;
+    if (v.factor == 1)  return v;
+    if (!ref || v.factor < ref->factor) ref = &v;
+  }
+  return ref ? *ref : u;
+}
+
 QVariant UnitsModel::data (const QModelIndex &index, int role) const {
   switch (role) {
   case Qt::DisplayRole: {
@@ -59,7 +76,9 @@ bool UnitsModel::setData(const QModelIndex &index, const QVariant &value,
   qDebug() << "setData(" << index << value << role << ")";
   if (role != Qt::EditRole)  return false;
 
-  atIndex(index.row()).text = value.toString();
+  UnitData &u = atIndex(index.row());
+  u.text = value.toString();
+  u.updateConversion();
   emit dataChanged(index, index, {role});
   return true;
 }
@@ -16,6 +16,10 @@ public:
   void add (const QString &text);
   void update (ID id, const QString &text);
 
+  /// Unit into which quantities of u are summed: the base unit of its
+  /// dimension (or the smallest one) if present, u itself otherwise
+  const UnitData& reference (const UnitData &u) const;
+
   int columnCount (const QModelIndex& = QModelIndex()) const override {
     return 2;
   }
@@ -1,7 +1,9 @@
 #include <QGuiApplication>
 #include <QScreen>
+#include <QMessageBox>
 
 #include "common.h"
+#include "../db/book.h"
 
 namespace gui {
 
@@ -67,4 +69,27 @@ void restore (QSettings &settings, const QString &key, QSplitter *s) {
   settings.endGroup();
 }
 
+bool confirmedClose (db::Book &book, QWidget *widget) {
+#ifndef Q_OS_ANDROID
+  if (!book.isModified()) return true;
+  auto ret = QMessageBox::warning(widget, "Confirmez",
+                                  "Sauvegarder les changements?",
+                                  QMessageBox::Yes | QMessageBox::No | QMessageBox::Cancel);
+  switch (ret) {
+  case QMessageBox::Yes:
+    book.autosave(false);
+    return true;
+  case QMessageBox::No:
+    return true;
+  case QMessageBox::Cancel:
+  default:
+    return false;
+  }
+#else
+  (void)book;
+  (void)widget;
+  return true;
+#endif
+}
+
 } // end of namespace gui
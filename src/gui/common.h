@@ -6,6 +6,10 @@
 
 #include <QDebug>
 
+namespace db {
+struct Book;
+} // end of namespace db
+
 namespace gui {
 
 template <typename T>
@@ -25,6 +29,9 @@ bool restoreGeometry (QWidget *w, QSettings &s);
 void save (QSettings &settings, const QString &key, const QSplitter *s);
 void restore (QSettings &settings, const QString &key, QSplitter *s);
 
+/// Offers to save pending changes. False if the user changed their mind
+bool confirmedClose (db::Book &book, QWidget *widget = nullptr);
+
 } // end of namespace gui
 
 #endif // COMMON_HPP
@@ -0,0 +1,78 @@
+#include <QVBoxLayout>
+#include <QGridLayout>
+#include <QFormLayout>
+#include <QDialogButtonBox>
+#include <QLabel>
+
+#include "exportdialog.h"
+#include "../db/book.h"
+
+#include <QDebug>
+
+namespace gui {
+
+ExportDialog::ExportDialog (const db::IDSet &filtered, db::ID current,
+                            QWidget *parent)
+  : QDialog(parent), _filtered(filtered), _current(current) {
+
+  auto &book = db::Book::current();
+
+  QVBoxLayout *layout = new QVBoxLayout;
+    QFormLayout *flayout = new QFormLayout;
+      _format = new QComboBox;
+      _format->addItem("PDF", db::PrintSnapshot::PDF);
+      _format->addItem("PDF (LaTeX)", db::PrintSnapshot::LATEX);
+      _format->addItem("Site HTML", db::PrintSnapshot::HTML);
+      flayout->addRow("Format", _format);
+    layout->addLayout(flayout);
+
+    QGridLayout *glayout = new QGridLayout;
+      QString title = (current != db::INVALID)
+                        ? book.recipes.at(current).title : QString("aucune");
+      glayout->addWidget(_recipe = new QRadioButton("Recette sélectionnée ("
+                                                    + title + ")"),
+                         0, 0, 1, 4);
+      glayout->addWidget(_filter = new QRadioButton(
+                           QString("Recettes filtrées (%1)")
+                           .arg(filtered.size())), 1, 0, 1, 4);
+      glayout->addWidget(_planning = new QRadioButton("Planning du"), 2, 0);
+      glayout->addWidget(_from = new QDateEdit(QDate::currentDate()), 2, 1);
+      glayout->addWidget(new QLabel("au"), 2, 2);
+      glayout->addWidget(_to = new QDateEdit(QDate::currentDate().addDays(6)),
+                         2, 3);
+    layout->addLayout(glayout);
+
+    auto *buttons = new QDialogButtonBox (QDialogButtonBox::Ok
+                                          | QDialogButtonBox::Cancel);
+    layout->addWidget(buttons);
+
+  setLayout(layout);
+  setWindowTitle("Exporter une sélection");
+
+  _recipe->setEnabled(current != db::INVALID);
+  _filter->setEnabled(!filtered.empty());
+  if (_recipe->isEnabled())       _recipe->setChecked(true);
+  else if (_filter->isEnabled())  _filter->setChecked(true);
+  else                            _planning->setChecked(true);
+
+  for (QDateEdit *e: {_from, _to}) {
+    e->setCalendarPopup(true);
+    connect(e, &QDateEdit::dateChanged, [this] { _planning->setChecked(true); });
+  }
+
+  connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+  connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+}
+
+db::PrintSnapshot::Format ExportDialog::format (void) const {
+  return db::PrintSnapshot::Format(_format->currentData().toInt());
+}
+
+db::IDSet ExportDialog::selection (void) const {
+  if (_recipe->isChecked())       return { _current };
+  else if (_filter->isChecked())  return _filtered;
+  else
+    return db::Book::current().planning.recipes(_from->date(), _to->date());
+}
+
+} // end of namespace gui
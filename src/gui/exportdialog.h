@@ -0,0 +1,34 @@
+#ifndef EXPORTDIALOG_H
+#define EXPORTDIALOG_H
+
+#include <QDialog>
+#include <QRadioButton>
+#include <QComboBox>
+#include <QDateEdit>
+
+#include "../db/pdfprint.h"
+
+namespace gui {
+
+/// Which recipes to print/export and in what format
+class ExportDialog : public QDialog {
+public:
+  ExportDialog (const db::IDSet &filtered, db::ID current, QWidget *parent);
+
+  db::PrintSnapshot::Format format (void) const;
+
+  /// The recipes asked for (subrecipes are added by the snapshot)
+  db::IDSet selection (void) const;
+
+private:
+  db::IDSet _filtered;
+  db::ID _current;
+
+  QComboBox *_format;
+  QRadioButton *_recipe, *_filter, *_planning;
+  QDateEdit *_from, *_to;
+};
+
+} // end of namespace gui
+
+#endif // EXPORTDIALOG_H
@@ -1,4 +1,5 @@
 #include <random>
+#include <algorithm>
 
 #include <QListWidgetItem>
 #include <QStyledItemDelegate>
@@ -14,6 +15,7 @@
 #include "filterview.h"
 #include "autofiltercombobox.hpp"
 #include "../db/book.h"
+#include "../db/query.h"
 
 namespace gui {
 
@@ -48,8 +50,9 @@ struct RecipeListDelegate : public QStyledItemDelegate {
 
       int x = 0;
       for (const QIcon &i: { r->basicIcon(), r->subrecipeIcon(),
-                             r->regimen->decoration, r->type->decoration,
-                             r->duration->decoration, r->status->decoration }) {
+                             r->regimen->decoration(), r->type->decoration(),
+                             r->duration->decoration(),
+                             r->status->decoration() }) {
         int w = h;
         i.paint(painter, x, S, w, h);
         x += w + M;
@@ -92,6 +95,20 @@ struct IngredientReference {
   }
 };
 
+struct PantryReference {
+  static constexpr int C = 1;
+  QString _data;
+
+  const QString& data (int) const {
+    return _data;
+  }
+
+  bool setData (int, const QVariant &value) {
+    _data = value.toString();
+    return true;
+  }
+};
+
 template <typename T>
 struct EditableModel : public QAbstractTableModel {
   using database_t = QList<T>;
@@ -166,6 +183,7 @@ struct RecipeFilter : public QSortFilterProxyModel {
   Data<QString> title;
   Data<bool> basic, subrecipe;
   Data<db::ID> regimen, type, duration, status;
+  Data<int> forgotten;
 
   using IngredientsModel = EditableModel<IngredientReference>;
   Data<IngredientsModel> ingredients;
@@ -173,6 +191,13 @@ struct RecipeFilter : public QSortFilterProxyModel {
   using RecipesModel = EditableModel<RecipeReference>;
   Data<RecipesModel> subrecipes;
 
+  using PantryModel = EditableModel<PantryReference>;
+  Data<PantryModel> pantry;
+  bool pantryRestricts = false;
+  QSet<db::ID> pantryMatches;
+
+  QString queryError;
+
   static constexpr int RandomRole = db::RecipesModel::SortRole+1;
 
   RecipeFilter (void) = default;
@@ -209,88 +234,126 @@ struct RecipeFilter : public QSortFilterProxyModel {
     if (!shuffled_ids.empty())
       return shuffled_ids[db::ID(source_left.data(db::IDRole).toInt())]
            < shuffled_ids[db::ID(source_right.data(db::IDRole).toInt())];
+    else if (source_left.column() == db::RecipesModel::titleColumn())
+      return db::Recipe::titleLess(
+        *source_left.data(db::PtrRole).value<const db::Recipe*>(),
+        *source_right.data(db::PtrRole).value<const db::Recipe*>());
     else
       return QSortFilterProxyModel::lessThan(source_left, source_right);
   }
 
-  bool filterAcceptsRow(int source_row,
-                        const QModelIndex &source_parent) const override {
-
-    const db::Recipe &r =
-      db::Book::current().recipes.at(
-        db::ID(sourceModel()->index(source_row, 0, source_parent)
-               .data(db::IDRole).toInt()));
-
-//    auto q = qDebug().nospace();
+  /// Translates the active criteria into the query plan
+  void compile (void) {
+    using db::Recipe;
+    using db::QueryPlan;
+    plan.clear();
+    queryError.clear();
 
-/*#define TEST(NAME) \
-  q << #NAME << " [" << (NAME? "on " : "off") << "]: " << NAME.data
-*/
-//    TEST(title) << " !C " << r.title << "? " << !r.title.contains(title.data)
-//                << "\n";
-    if (title && !title.data.isEmpty()
-        && !r.title.contains(title.data, Qt::CaseInsensitive)) return false;
+    if (title && !title.data.isEmpty() && !plan.parse(title.data, &queryError)) {
+      QString t = title.data;
+      plan.add("title:" + t, QueryPlan::TextCost, [t] (const Recipe &r) {
+        return r.title.contains(t, Qt::CaseInsensitive);
+      });
+    }
 
-//    TEST(basic) << " != " << r.basic << "? " << (r.basic != basic.data) << "\n";
-    if (basic && r.basic != basic.data)  return false;
+    if (basic) {
+      bool b = basic.data;
+      plan.add("basic:" + QString::number(b), QueryPlan::CheapCost,
+               [b] (const Recipe &r) { return r.basic == b; });
+    }
 
-//    TEST(subrecipe) << " != " << r.used << "? " << (bool(r.used) != subrecipe.data) << "\n";
-    if (subrecipe && bool(r.used) != subrecipe.data)  return false;
+    if (subrecipe) {
+      bool b = subrecipe.data;
+      plan.add("used:" + QString::number(b), QueryPlan::CheapCost,
+               [b] (const Recipe &r) { return bool(r.used) == b; });
+    }
 
-#define TEST_CB(NAME) \
-  if (NAME && r.NAME->id != NAME.data) return false;
+#define COMPILE_CB(NAME)                                                \
+    if (NAME) {                                                         \
+      db::ID id = NAME.data;                                            \
+      plan.add(#NAME ":" + QString::number(id), QueryPlan::CheapCost,   \
+               [id] (const Recipe &r) { return r.NAME->id == id; });    \
+    }
 
-    TEST_CB(regimen)
-    TEST_CB(status)
-    TEST_CB(type)
-    TEST_CB(duration)
-#undef TEST_CB
+    COMPILE_CB(regimen)
+    COMPILE_CB(status)
+    COMPILE_CB(type)
+    COMPILE_CB(duration)
+#undef COMPILE_CB
+
+    if (forgotten) {
+      int months = forgotten.data;
+      auto forgottenSince = db::Book::current().history.forgottenSince(months);
+      plan.add("forgotten:" + QString::number(months), QueryPlan::CheapCost,
+               [forgottenSince] (const Recipe &r) {
+        return forgottenSince(r.id);
+      });
+    }
 
     if (ingredients) {
-      int found = 0;
       for (const auto &s: ingredients.data()) {
-        if (s._data[0].isEmpty()) {
-          found++;
-          continue;
-        }
-//        q << "\t" << s._data[0];
-//        if (!s._data[1].isEmpty())  q << " (" << s._data[1] << ")";
-//        q << "\n";
-        for (const auto &i: r.ingredients) {
-          if (i->etype != db::EntryType::Ingredient) continue;
-          auto ientry = static_cast<db::IngredientEntry*>(i.data());
-//          q << "\t\t" << ientry->idata->text << " (" << ientry->qualif << ")\n";
-          if (!ientry->idata->text.contains(s._data[0], Qt::CaseInsensitive))
-            continue;
-          if (!ientry->qualif.contains(s._data[1], Qt::CaseInsensitive))
-            continue;
-          found++;
-          break;
-        }
+        if (s._data[0].isEmpty()) continue;
+        QString ingredient = s._data[0], qualif = s._data[1];
+        auto signature = db::IngredientSignature::query(ingredient, qualif);
+        plan.add("ingredient:" + ingredient + "/" + qualif,
+                 QueryPlan::ListCost,
+                 [ingredient, qualif, signature] (const Recipe &r) {
+          if (!r.signature.mayMatch(signature)) return false;
+          for (const auto &i: r.ingredients) {
+            if (i->etype != db::EntryType::Ingredient) continue;
+            auto ientry = static_cast<db::IngredientEntry*>(i.data());
+            if (ientry->idata->text.contains(ingredient, Qt::CaseInsensitive)
+                && ientry->qualif.contains(qualif, Qt::CaseInsensitive))
+              return true;
+          }
+          return false;
+        });
       }
-      if (found != ingredients.data().size())  return false;
     }
 
     if (subrecipes) {
-      int found = 0;
       for (const auto &s: subrecipes.data()) {
         if (s._data.isEmpty()) continue;
-        for (const auto &i: r.ingredients) {
-          if (i->etype != db::EntryType::SubRecipe) continue;
-          auto sentry = static_cast<db::SubRecipeEntry*>(i.data());
-          if (!sentry->recipe->title.contains(s._data, Qt::CaseInsensitive))
-            continue;
-          found++;
-          break;
-        }
+        QString subtitle = s._data;
+        plan.add("subrecipe:" + subtitle, QueryPlan::ListCost,
+                 [subtitle] (const Recipe &r) {
+          for (const auto &i: r.ingredients) {
+            if (i->etype != db::EntryType::SubRecipe) continue;
+            auto sentry = static_cast<db::SubRecipeEntry*>(i.data());
+            if (sentry->recipe->title.contains(subtitle, Qt::CaseInsensitive))
+              return true;
+          }
+          return false;
+        });
       }
-      if (found != subrecipes.data().size())  return false;
     }
 
-#undef TEST
-//    q << "Accepting row\n";
-    return true;
+    if (pantry && pantryRestricts) {
+      QSet<db::ID> matches = pantryMatches;
+      std::vector<db::ID> ids (matches.begin(), matches.end());
+      std::sort(ids.begin(), ids.end());
+      QStringList key;
+      for (db::ID id: ids)  key << QString::number(id);
+      plan.add("pantry:" + key.join(","), QueryPlan::CheapCost,
+               [matches] (const Recipe &r) {
+        return matches.contains(r.id);
+      });
+    }
   }
+
+  bool filterAcceptsRow(int source_row,
+                        const QModelIndex &source_parent) const override {
+
+    const db::Recipe &r =
+      db::Book::current().recipes.at(
+        db::ID(sourceModel()->index(source_row, 0, source_parent)
+               .data(db::IDRole).toInt()));
+
+    return plan.accepts(r);
+  }
+
+private:
+  db::QueryPlan plan;
 };
 
 struct IngredientReferenceDelegate : public QStyledItemDelegate {
@@ -485,12 +548,19 @@ FilterView::FilterView (QWidget *parent)
   QGridLayout *layout = new QGridLayout;
 
   title = new Entry<QLineEdit> ("Titre", layout);
+  title->widget->setPlaceholderText("ing:farine -regime:vegan duree:<=journée");
   basic = new Entry<YesNoGroupBox> ("Basique", layout);
   subrecipe = new Entry<YesNoGroupBox> ("Sous-Recette", layout);
   regimen = new Entry<QComboBox> ("Régime", layout);
   type = new Entry<QComboBox> ("Type", layout);
   duration = new Entry<QComboBox> ("Durée", layout);
   status = new Entry<QComboBox> ("Status", layout);
+  forgotten = new Entry<QSpinBox> ("Oubliée depuis", layout);
+  forgotten->widget->setRange(1, 120);
+  forgotten->widget->setValue(3);
+  forgotten->widget->setSuffix(" mois");
+  forgotten->widget->setToolTip("Recettes absentes de l'historique du planning"
+                                " depuis ce nombre de mois");
 
 #ifndef Q_OS_ANDROID
   ingredients = new Entry<QTableView> ("Ingrédients", layout);
@@ -520,6 +590,22 @@ FilterView::FilterView (QWidget *parent)
   scontrols->setNeedsConfirmation(false);
   connect(subrecipes->cb, &QCheckBox::toggled,
           scontrols, &ListControls::setEnabled);
+
+  pantry = new Entry<QListView> ("Placard", layout);
+  pantry->widget->setModel(&_filter->pantry.data);
+  layout->addWidget(pcontrols = new ListControls (pantry->widget,
+                                                  QBoxLayout::TopToBottom),
+                    layout->rowCount()-1, 3);
+  pcontrols->editButton()->hide();
+  pcontrols->setNeedsConfirmation(false);
+  connect(pantry->cb, &QCheckBox::toggled,
+          pcontrols, &ListControls::setEnabled);
+
+  layout->addWidget(pantryResults = new QListWidget,
+                    layout->rowCount(), 1, 1, 2);
+  connect(pantry->cb, &QCheckBox::toggled,
+          pantryResults, &QListWidget::setVisible);
+  pantryResults->setVisible(false);
 #endif
 
   QHBoxLayout *blayout = new QHBoxLayout;
@@ -546,6 +632,10 @@ FilterView::FilterView (QWidget *parent)
   duration->widget->setModel(db::getStaticModel<db::DurationData>());
 
   connectMany(title, &QLineEdit::textChanged);
+
+  // Queries resolved through indexes must be recompiled after edits
+  connect(&db::Book::current().recipes, &QAbstractItemModel::dataChanged,
+          this, &FilterView::processFilterChanges);
   connectMany(basic);
   connect(basic->widget->buttons[1], &QRadioButton::toggled,
           this, &FilterView::processFilterChanges);
@@ -554,6 +644,7 @@ FilterView::FilterView (QWidget *parent)
           this, &FilterView::processFilterChanges);
   for (const auto &cb: {regimen, status, type, duration})
     connectMany(cb, QOverload<int>::of(&QComboBox::currentIndexChanged));
+  connectMany(forgotten, QOverload<int>::of(&QSpinBox::valueChanged));
 
 #ifndef Q_OS_ANDROID
   connectMany(ingredients);
@@ -585,6 +676,20 @@ FilterView::FilterView (QWidget *parent)
   connect(scontrols->delButton(), &QToolButton::clicked,
           this, &FilterView::processFilterChanges);
 
+  connectMany(pantry);
+  connect(pantry->widget->model(), &QAbstractItemModel::dataChanged,
+          this, &FilterView::processFilterChanges);
+  pantry->widget->setItemDelegate(
+    new IngredientReferenceDelegate(pantry->widget->model()));
+  connect(pcontrols->addButton(), &QToolButton::clicked,
+          [this] {
+    QModelIndex inserted = _filter->pantry.data.append();
+    pantry->widget->setCurrentIndex(inserted);
+    pantry->widget->edit(inserted);
+  });
+  connect(pcontrols->delButton(), &QToolButton::clicked,
+          this, &FilterView::processFilterChanges);
+
   /// TODO Remove (?)
   ingredients->cb->setChecked(true);
   subrecipes->cb->setChecked(true);
@@ -650,6 +755,10 @@ void FilterView::processFilterChanges (void) {
   UPDATE_CB(duration)
 #undef UPDATE_CB
 
+  TEST(forgotten, value)
+  _filter->forgotten.active = forgotten->cb->isChecked();
+  _filter->forgotten.data = forgotten->widget->value();
+
 #ifndef Q_OS_ANDROID
 //    q << "ingredients: " << ingredients->widget->model()->rowCount()
 //      << " items:\n";
@@ -662,18 +771,60 @@ void FilterView::processFilterChanges (void) {
 //    for (const auto &i: filter->subrecipes.data())
 //      q << "\t" << i._data << "\n";
   _filter->subrecipes.active = subrecipes->cb->isChecked();
+
+  _filter->pantry.active = pantry->cb->isChecked();
+  updatePantry();
 #endif
 
+  _filter->compile();
+  title->widget->setToolTip(_filter->queryError);
+  title->widget->setStyleSheet(_filter->queryError.isEmpty() ? ""
+                                                             : "color: red");
   _filter->invalidate();
   emit filterChanged();
 }
 
+#ifndef Q_OS_ANDROID
+void FilterView::updatePantry (void) {
+  _filter->pantryRestricts = false;
+  _filter->pantryMatches.clear();
+  pantryResults->clear();
+  if (!_filter->pantry) return;
+
+  auto &book = db::Book::current();
+  db::Pantry::IngredientSet available;
+  for (const auto &p: _filter->pantry.data()) {
+    if (p._data.isEmpty())  continue;
+    for (const auto &i: book.ingredients)
+      if (i.second.text.contains(p._data, Qt::CaseInsensitive))
+        available.insert(i.first);
+  }
+  if (available.empty())  return;
+
+  _filter->pantryRestricts = true;
+  for (const db::Pantry::Match &m: book.pantry.rank(available)) {
+    _filter->pantryMatches.insert(m.recipe->id);
+
+    QStringList missing;
+    for (db::ID id: m.missing)  missing << book.ingredients.at(id).text;
+
+    auto *item = new QListWidgetItem(
+      m.recipe->title + " (" + QString::number(m.covered) + "/"
+      + QString::number(m.total) + ")");
+    if (!missing.empty())
+      item->setToolTip("Manque: " + missing.join(", "));
+    pantryResults->addItem(item);
+  }
+}
+#endif
+
 void FilterView::clear (void) {
   for (QCheckBox *cb: { title->cb,
                         basic->cb, subrecipe->cb,
                         regimen->cb, status->cb, type->cb, duration->cb,
+                        forgotten->cb,
 #ifndef Q_OS_ANDROID
-                        ingredients->cb, subrecipes->cb
+                        ingredients->cb, subrecipes->cb, pantry->cb
 #endif
                       }) {
 
@@ -688,6 +839,7 @@ void FilterView::clear (void) {
 
   _filter->ingredients.data.clear();
   _filter->subrecipes.data.clear();
+  _filter->pantry.data.clear();
   processFilterChanges();
 }
 
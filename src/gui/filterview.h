@@ -5,9 +5,11 @@
 #include <QCheckBox>
 #include <QRadioButton>
 #include <QComboBox>
+#include <QSpinBox>
 #include <QLabel>
 #include <QTableView>
 #include <QListView>
+#include <QListWidget>
 #include <QGridLayout>
 #include <QSortFilterProxyModel>
 
@@ -35,11 +37,16 @@ class FilterView : public QWidget {
   Entry<QLineEdit> *title;
   Entry<YesNoGroupBox> *basic, *subrecipe;
   Entry<QComboBox> *regimen, *status, *type, *duration;
+  Entry<QSpinBox> *forgotten;
 
 #ifndef Q_OS_ANDROID
   Entry<QTableView> *ingredients;
   Entry<QListView> *subrecipes;
   ListControls *icontrols, *scontrols;
+
+  Entry<QListView> *pantry;
+  ListControls *pcontrols;
+  QListWidget *pantryResults;
 #endif
 
 public:
@@ -55,6 +62,9 @@ private:
   void connectMany (Entry<T> *entry, SRC... members);
 
   void processFilterChanges (void);
+#ifndef Q_OS_ANDROID
+  void updatePantry (void);
+#endif
   void clear (void);
   void random (void);
 };
@@ -42,6 +42,12 @@
 
 #include "../db/settings.h"
 #include "../db/recipesmodel.h"
+#ifndef Q_OS_ANDROID
+#include <QProgressDialog>
+#include "../db/printjob.h"
+#include "../db/htmlexport.h"
+#include "exportdialog.h"
+#endif
 
 
 namespace gui {
@@ -109,6 +115,12 @@ Book::Book(QWidget *parent) : QMainWindow(parent) {
 //                        [this] { saveRecipes(); },
 //                        QKeySequence("Ctrl+Shift+S"));
       add(m_book, "document-print", "&Print", "Ctrl+P", [this] { printRecipes(); });
+      add(m_book, "", "Print (LaTeX)", "", [this] {
+        printRecipes(db::PrintSnapshot::LATEX);
+      });
+      add(m_book, "", "Export (HTML)", "", [this] { exportSite(); });
+      add(m_book, "", "Export selection", "Ctrl+Shift+P",
+          [this] { exportSelection(); });
 #endif
 
       QAction *filterAction =
@@ -155,6 +167,14 @@ Book::Book(QWidget *parent) : QMainWindow(parent) {
 
 
 #ifndef Q_OS_ANDROID
+  _server = new db::HttpServer (db::Book::current(), this);
+  updateServer();
+  connect(db::Settings::instance(), &db::Settings::settingChanged,
+          this, [this] (db::Settings::Type t) {
+    if (t == db::Settings::HTTP_SERVER || t == db::Settings::HTTP_PORT)
+      updateServer();
+  });
+
   gui::restore(settings, "vsplitter", _vsplitter);
   gui::restore(settings, "hsplitter", _hsplitter);
 //  _hsplitter->setVisible(true); /// TODO Remove
@@ -240,8 +260,90 @@ bool Book::overwriteRecipes(bool spontaneous) {
   return db::Book::current().autosave(spontaneous);
 }
 
-bool Book::printRecipes(void) {
-  return db::Book::current().print();
+void Book::printRecipes(db::PrintSnapshot::Format format,
+                        const QString &output, const db::IDSet *selection) {
+  auto *job = new db::PrintJob (db::Book::current(), format, output,
+                                selection, this);
+  auto *progress = new QProgressDialog ("Impression...", "Annuler", 0, 0, this);
+  progress->setWindowModality(Qt::WindowModal);
+  progress->setMinimumDuration(500);
+
+  connect(job, &db::PrintJob::progress,
+          progress, [progress] (int done, int total) {
+    progress->setMaximum(total);
+    progress->setValue(done);
+  });
+  connect(progress, &QProgressDialog::canceled, job, &db::PrintJob::cancel);
+  connect(job, &db::PrintJob::finished, this, [this, job, progress] (bool ok) {
+    progress->deleteLater();
+    job->deleteLater();
+    if (ok)
+      statusBar()->showMessage("Impression terminée", 5000);
+    else if (!job->isCancelled())
+      QMessageBox::warning(this, "Erreur", "Echec de l'impression");
+  });
+
+  job->start();
+}
+
+void Book::exportSite(void) {
+  QString dir = QFileDialog::getExistingDirectory(this, "Exporter le site",
+                                                  db::siteOutput());
+  if (!dir.isEmpty())  printRecipes(db::PrintSnapshot::HTML, dir);
+}
+
+void Book::updateServer(void) {
+  bool enabled = db::Settings::value<bool>(db::Settings::HTTP_SERVER);
+  quint16 port = db::Settings::value<int>(db::Settings::HTTP_PORT);
+  if (_server->isListening() && (!enabled || _server->port() != port))
+    _server->close();
+
+  if (enabled && !_server->isListening()) {
+    if (_server->listen(port))
+      statusBar()->showMessage(
+        QString("Livre accessible sur le port %1").arg(port), 5000);
+    else
+      QMessageBox::warning(this, "Serveur HTTP",
+                           "Impossible d'écouter sur le port "
+                           + QString::number(port) + ": "
+                           + _server->errorString());
+  }
+}
+
+void Book::exportSelection(void) {
+  auto *proxy = _filter->proxyModel();
+  db::IDSet filtered;
+  for (int r=0; r<proxy->rowCount(); r++)
+    filtered.insert(db::ID(proxy->index(r, 0).data(db::IDRole).toInt()));
+
+  QModelIndex index = _recipes->currentIndex();
+  db::ID current = index.isValid()
+                    ? db::ID(index.data(db::IDRole).toInt())
+                    : db::INVALID;
+
+  ExportDialog dialog (filtered, current, this);
+  if (!dialog.exec()) return;
+
+  db::IDSet selection = dialog.selection();
+  if (selection.empty()) {
+    QMessageBox::information(this, "Exporter une sélection",
+                             "Aucune recette sélectionnée");
+    return;
+  }
+
+  QString output;
+  auto format = dialog.format();
+  if (format == db::PrintSnapshot::HTML)
+    output = QFileDialog::getExistingDirectory(this, "Exporter le site",
+                                               db::siteOutput());
+  else
+    output = QFileDialog::getSaveFileName(this, "Exporter en PDF",
+                                          db::Book::monitoredDir()
+                                            + "/selection.pdf",
+                                          "PDF (*.pdf)");
+  if (output.isEmpty()) return;
+
+  printRecipes(format, output, &selection);
 }
 #endif
 
@@ -317,7 +419,7 @@ void Book::setAutoTitle(void) {
 void Book::closeEvent(QCloseEvent *e) {
 #ifndef Q_OS_ANDROID
   auto &book = db::Book::current();
-  if (!book.close(this)) {
+  if (!confirmedClose(book, this)) {
     e->ignore();
     return;
   } else
@@ -8,6 +8,8 @@
 #include <QTableView>
 
 #include "../db/book.h"
+#include "../db/pdfprint.h"
+#include "../db/httpserver.h"
 #include "gui_recipe.h"
 #include "autofiltercombobox.hpp"
 
@@ -25,7 +27,11 @@ public:
   bool loadDefaultBook(void);
 #ifndef Q_OS_ANDROID
   bool overwriteRecipes(bool spontaneous = true);
-  bool printRecipes(void);
+  void printRecipes(db::PrintSnapshot::Format format = db::PrintSnapshot::PDF,
+                    const QString &output = QString(),
+                    const db::IDSet *selection = nullptr);
+  void exportSite(void);
+  void exportSelection(void);
 #endif
 
   void closeEvent(QCloseEvent *e) override;
@@ -41,6 +47,10 @@ private:
   FilterView *_filter;
   PlanningView *_planning;
 
+#ifndef Q_OS_ANDROID
+  db::HttpServer *_server;
+#endif
+
   void buildLayout (void);
 
 #ifndef Q_OS_ANDROID
@@ -54,6 +64,9 @@ private:
   void showUpdateManager (void);
   void showRepairUtility (void);
   void showSettings (void);
+
+  /// Starts, restarts or stops the http server as configured
+  void updateServer (void);
 #endif
   void showSynchronizer(void);
   void showAbout (void);
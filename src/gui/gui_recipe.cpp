@@ -438,6 +438,7 @@ const T* getData (const QComboBox *cb) {
 #ifndef Q_OS_ANDROID
 void Recipe::writeThrough(void) {
   _data->title = _title->text();
+  _data->updateTitleKey();
 
   _data->basic = _edit.basic->isChecked();
   _data->regimen = getData<db::RegimenData>(_edit.regimen);
@@ -452,6 +453,7 @@ void Recipe::writeThrough(void) {
       static_cast<const IngredientListItem*>(_ingredients->item(i))->ing);
   _data->updateUsageCounts(newIngredients);
   _data->ingredients = newIngredients;
+  _data->updateSignature();
 
   _data->steps.clear();
   for (int i=0; i<_steps->count(); i++)
@@ -482,10 +484,10 @@ void Recipe::setReadOnly(bool ro) {
     if (ro) { // copy from edit to consult
       pixmap(_consult.basic, _data->basicIcon());
       pixmap(_consult.subrecipe, _data->subrecipeIcon());
-      pixmap(_consult.regimen, _data->regimen->decoration);
-      pixmap(_consult.type, _data->type->decoration);
-      pixmap(_consult.duration, _data->duration->decoration);
-      pixmap(_consult.status, _data->status->decoration);
+      pixmap(_consult.regimen, _data->regimen->decoration());
+      pixmap(_consult.type, _data->type->decoration());
+      pixmap(_consult.duration, _data->duration->decoration());
+      pixmap(_consult.status, _data->status->decoration());
 
     } else {  // copy from consult to edit
 #ifndef Q_OS_ANDROID
@@ -562,6 +564,7 @@ void Recipe::apply(void) {
 }
 
 bool Recipe::confirmed(void) {
+  if (!acyclic()) return false;
   if (QMessageBox::question(this, tr("Valider?"), "Confirmez la modification?",
                             QMessageBox::Yes | QMessageBox::No)
       == QMessageBox::Yes) {
@@ -570,6 +573,26 @@ bool Recipe::confirmed(void) {
   }
   return false;
 }
+
+bool Recipe::acyclic(void) {
+  decltype(_data->ingredients) newIngredients;
+  for (int i=0; i<_ingredients->count(); i++)
+    newIngredients.append(
+      static_cast<const IngredientListItem*>(_ingredients->item(i))->ing);
+
+  const auto &recipes = db::Book::current().recipes;
+  auto cycle = recipes.graph().cycle(
+    _data->id, db::RecipeGraph::subrecipesOf(newIngredients));
+  if (cycle.empty())  return true;
+
+  QStringList titles { _title->text() };
+  for (db::ID id: cycle)  titles.append(recipes.at(id).title);
+  QMessageBox::warning(this, "Illégal",
+                       "Cette recette se contiendrait elle-même:\n"
+                       + titles.join(" → "),
+                       QMessageBox::Ok);
+  return false;
+}
 #endif
 
 #ifndef Q_OS_ANDROID
@@ -662,6 +685,15 @@ void Recipe::updateDisplayedPortions(bool spontaneous) {
   for (int i=0; i<_ingredients->count(); i++)
     static_cast<IngredientListItem*>(_ingredients->item(i))->setRatio(r);
   /// TODO Kind of ugly (but functional)
+
+  auto &book = db::Book::current();
+  if (_data->id != db::INVALID
+      && !book.recipes.graph().subrecipes(_data->id).empty()) {
+    auto &e = book.expansion;
+    _ingredients->setToolTip(
+      "Au total:\n" + e.format(e.of(*_data), r).join("\n"));
+  } else
+    _ingredients->setToolTip("");
 }
 
 void Recipe::showPrevious(void) {
@@ -726,6 +758,10 @@ bool Recipe::safeQuit(QEvent *e) {
                                   QMessageBox::Yes | QMessageBox::No | QMessageBox::Cancel);
   switch (ret) {
   case QMessageBox::Yes:
+    if (!acyclic()) {
+      e->ignore();
+      return false;
+    }
     writeThrough();
     return true;
   case QMessageBox::No:
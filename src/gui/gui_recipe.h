@@ -99,6 +99,7 @@ private:
 
   void toggleReadOnly (void);
   bool confirmed(void);
+  bool acyclic (void);
   void apply (void);
 
   void writeThrough (void);
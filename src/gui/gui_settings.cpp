@@ -69,6 +69,11 @@ QWidget* factory (db::Settings::Type stype) {
     QHBoxLayout *layout = new QHBoxLayout;
     layout->addWidget(new QLabel(data.displayName));
     auto sb = new QSpinBox;
+    if (stype == db::Settings::HTTP_PORT) {
+      sb->setRange(1024, 65535);
+      // Not on every keystroke: each value would restart the server
+      sb->setKeyboardTracking(false);
+    }
     sb->setValue(db::Settings::value<int>(stype));
     SettingsView::connect(sb, QOverload<int>::of(&QSpinBox::valueChanged),
                           [stype] (int value) {
@@ -100,6 +105,9 @@ SettingsView::SettingsView(QWidget *parent) : QDialog(parent) {
 
     } else if (t == Type::MODAL_IMANAGER) {
       addSection(layout, "Fenêtres bloquantes");
+
+    } else if (t == Type::HTTP_SERVER) {
+      addSection(layout, "Réseau");
     }
 
     layout->addWidget(factory(t));
@@ -0,0 +1,95 @@
+#include <QVBoxLayout>
+#include <QFormLayout>
+#include <QDialogButtonBox>
+#include <QMessageBox>
+#include <QRandomGenerator>
+
+#include "mealplannerview.h"
+#include "../db/book.h"
+#include "../db/settings.h"
+
+#include <QDebug>
+
+namespace gui {
+
+MealPlannerView::MealPlannerView (QWidget *parent) : QDialog(parent) {
+  db::MealPlanner::Options defaults;
+
+  QVBoxLayout *layout = new QVBoxLayout;
+    QFormLayout *flayout = new QFormLayout;
+      _days = new QSpinBox;
+      _days->setRange(1, db::Settings::value<int>(
+                           db::Settings::PLANNING_WINDOW));
+      _days->setValue(_days->maximum());
+      _days->setSuffix(" jours");
+      flayout->addRow("Sur", _days);
+
+      QHBoxLayout *mlayout = new QHBoxLayout;
+      for (int i=0; i<db::PlanningModel::ROWS; i++) {
+        _meals[i] = new QCheckBox(db::PlanningModel::mealName(i));
+        _meals[i]->setChecked(defaults.meals[i]);
+        mlayout->addWidget(_meals[i]);
+      }
+      flayout->addRow("Repas", mlayout);
+
+      _duration = new QComboBox;
+      _duration->setModel(db::getStaticModel<db::DurationData>());
+      _duration->setCurrentIndex(
+        _duration->findData(int(defaults.weekdayDuration), db::IDRole));
+      flayout->addRow("En semaine, au plus", _duration);
+
+      _noRepeat = new QSpinBox;
+      _noRepeat->setRange(1, 60);
+      _noRepeat->setValue(defaults.noRepeat);
+      _noRepeat->setSuffix(" jours");
+      flayout->addRow("Pas de répétition sur", _noRepeat);
+
+      for (const db::RegimenData &d: db::RegimenData::database()) {
+        QSpinBox *s = new QSpinBox;
+        s->setRange(0, 100);
+        s->setSuffix(" %");
+        s->setSpecialValueText("Indifférent");
+        flayout->addRow(d.text, _regimens[d.id] = s);
+      }
+    layout->addLayout(flayout);
+
+    auto *buttons = new QDialogButtonBox (QDialogButtonBox::Ok
+                                          | QDialogButtonBox::Cancel);
+    layout->addWidget(buttons);
+
+  setLayout(layout);
+  setWindowTitle("Planification automatique");
+
+  connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+  connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+}
+
+db::MealPlanner::Options MealPlannerView::options (void) const {
+  db::MealPlanner::Options o;
+  o.days = _days->value();
+  for (int i=0; i<db::PlanningModel::ROWS; i++)
+    o.meals[i] = _meals[i]->isChecked();
+  o.weekdayDuration = db::ID(_duration->currentData(db::IDRole).toInt());
+  o.noRepeat = _noRepeat->value();
+  for (const auto &p: _regimens)
+    if (p.second->value() > 0)  o.regimens[p.first] = p.second->value();
+  return o;
+}
+
+void MealPlannerView::accept (void) {
+  auto &book = db::Book::current();
+  db::MealPlanner planner (book.recipes, book.planning, book.history);
+  auto plan = planner.plan(options(), QRandomGenerator::global()->generate());
+  if (plan.empty()) {
+    QMessageBox::information(this, "Planification automatique",
+                             "Aucun repas à planifier");
+    return;
+  }
+
+  for (const auto &a: plan)
+    book.planning.setItems(book.planning.cell(a.date, a.meal),
+                           { a.recipe }, {}, true);
+  QDialog::accept();
+}
+
+} // end of namespace gui
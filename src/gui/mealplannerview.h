@@ -0,0 +1,31 @@
+#ifndef MEALPLANNERVIEW_H
+#define MEALPLANNERVIEW_H
+
+#include <QDialog>
+#include <QSpinBox>
+#include <QCheckBox>
+#include <QComboBox>
+
+#include "../db/mealplanner.h"
+
+namespace gui {
+
+/// Options of the automatic planning. Fills the empty cells when accepted
+class MealPlannerView : public QDialog {
+public:
+  MealPlannerView (QWidget *parent);
+
+  void accept (void) override;
+
+private:
+  QSpinBox *_days, *_noRepeat;
+  std::array<QCheckBox*, db::PlanningModel::ROWS> _meals;
+  QComboBox *_duration;
+  std::map<db::ID, QSpinBox*> _regimens;
+
+  db::MealPlanner::Options options (void) const;
+};
+
+} // end of namespace gui
+
+#endif // MEALPLANNERVIEW_H
@@ -14,6 +14,10 @@
 #include "planningview.h"
 #include "gui_recipe.h"
 #include "androidspecifics.hpp"
+#ifndef Q_OS_ANDROID
+#include "shoppinglistview.h"
+#include "mealplannerview.h"
+#endif
 #include "../db/book.h"
 
 #include <QDebug>
@@ -265,6 +269,22 @@ PlanningView::PlanningView(QWidget *parent) : QDialog(parent) {
     today->setToolTip(tr("Afficher aujourd'hui"));
     connect(today, &QToolButton::clicked, this, &PlanningView::showToday);
     blayout->addWidget(today);
+
+    QToolButton *shopping = new QToolButton;
+    shopping->setIcon(QApplication::style()->standardIcon(
+                        QStyle::SP_FileDialogDetailedView));
+    shopping->setToolTip(tr("Liste de courses"));
+    connect(shopping, &QToolButton::clicked,
+            [this] { ShoppingListView (this).exec(); });
+    blayout->addWidget(shopping);
+
+    QToolButton *planner = new QToolButton;
+    planner->setIcon(QApplication::style()->standardIcon(
+                       QStyle::SP_BrowserReload));
+    planner->setToolTip(tr("Compléter automatiquement"));
+    connect(planner, &QToolButton::clicked,
+            [this] { MealPlannerView (this).exec(); });
+    blayout->addWidget(planner);
   layout->addLayout(blayout);
 
 #else
@@ -61,9 +61,9 @@ struct CachedAnalysis {
                                     std::pair<db::Recipe*,
                                               db::IngredientEntry*>>>>;
 
-  homonymous_t<std::pair<const QString&, const QString&>,
+  homonymous_t<std::pair<const QString&, const db::AlimentaryGroupData*>,
                db::IngredientData> ihomonymous;
-  homonymous_t<std::reference_wrapper<const QString>, db::UnitData> uhomonymous;
+  homonymous_t<QString, db::UnitData> uhomonymous;
 
   void reset (void) {
     rcounts.clear();
@@ -231,8 +231,9 @@ void RepairsManager::summaryChecked(Summary *s, bool checked) {
     _resultsDisplayer->setTabIcon(i, s->tabIcon());
 }
 
-std::pair<const QString&, const QString&> hkey (const db::IngredientData &id) {
-  return { id.text, id.group->text };
+std::pair<const QString&, const db::AlimentaryGroupData*>
+hkey (const db::IngredientData &id) {
+  return { id.text, id.group };
 }
 
 void RepairsManager::checkAll(void) {
@@ -250,7 +251,7 @@ void RepairsManager::checkAll(void) {
   }
   for (auto &p: book.units) {
     _results->ucounts[&p.second] = 0;
-    _results->uhomonymous[p.second.text][&p.second] = {};
+    _results->uhomonymous[p.second.key()][&p.second] = {};
   }
 
   for (auto &p: book.recipes) {
@@ -263,7 +264,7 @@ void RepairsManager::checkAll(void) {
         auto &ih = _results->ihomonymous[hkey(*e.idata)];
         if (ih.size() > 1)  ih[e.idata].push_back({&p.second, &e});
 
-        auto &uh = _results->uhomonymous[e.unit->text];
+        auto &uh = _results->uhomonymous[e.unit->key()];
         if (uh.size() > 1)  uh[e.unit].push_back({&p.second, &e});
 
       } else if (li->etype == EntryType::SubRecipe)
@@ -313,7 +314,8 @@ void RepairsManager::checkAll(void) {
     Summary *s = _summaries.value(Analysis::HOMONYMOUS_INGREDIENT);
     if (s->empty()) s->insertInto(_resultsDisplayer);
     auto stream = s->append();
-    stream << p.first.first << " (" << p.first.second << "):\n";
+    stream << p.first.first << " (" << QString(p.first.second->text)
+           << "):\n";
     for (const auto &d: p.second) {
       stream << "  " << d.first->id;
       if (d.second.size() > 0) {
@@ -334,7 +336,7 @@ void RepairsManager::checkAll(void) {
     auto stream = s->append();
     stream << p.first << ":\n";
     for (const auto &d: p.second) {
-      stream << "  " << d.first->id;
+      stream << "  " << d.first->id << " '" << d.first->text << "'";
       if (d.second.size() > 0) {
         stream << " dans :\n";
         for (const auto &r: d.second)
@@ -405,7 +407,10 @@ void RepairsManager::correct(void) {
 
       map.erase(iptr);
       for (auto &d: map) {
-        for (auto &e: d.second) e.second->idata = iptr;
+        for (auto &e: d.second) {
+          e.second->idata = iptr;
+          e.first->updateSignature();
+        }
         iptr->used += d.first->used;
         db::Book::current().ingredients.removeItem(d.first->id);
 
@@ -0,0 +1,86 @@
+#include <QVBoxLayout>
+#include <QFormLayout>
+#include <QDialogButtonBox>
+#include <QPushButton>
+#include <QHeaderView>
+#include <QApplication>
+#include <QClipboard>
+
+#include "shoppinglistview.h"
+#include "../db/book.h"
+#include "../db/settings.h"
+
+#include <QDebug>
+
+namespace gui {
+
+ShoppingListView::ShoppingListView (QWidget *parent) : QDialog(parent) {
+  auto &shopping = db::Book::current().shopping;
+
+  QVBoxLayout *layout = new QVBoxLayout;
+    QFormLayout *flayout = new QFormLayout;
+      _portions = new QDoubleSpinBox;
+      _portions->setRange(0, 100);
+      _portions->setDecimals(1);
+      _portions->setSpecialValueText("Selon la recette");
+      _portions->setValue(shopping.portions());
+      flayout->addRow("Portions par repas", _portions);
+    layout->addLayout(flayout);
+
+    _list = new QTreeWidget;
+    _list->setHeaderHidden(true);
+    _list->setRootIsDecorated(false);
+    layout->addWidget(_list);
+
+    auto *buttons = new QDialogButtonBox (QDialogButtonBox::Close);
+    QPushButton *copy = buttons->addButton("Copier",
+                                           QDialogButtonBox::ActionRole);
+    layout->addWidget(buttons);
+
+  setLayout(layout);
+  setWindowTitle(QString("Liste de courses (%1 jours)")
+                 .arg(db::Settings::value<int>(db::Settings::PLANNING_WINDOW)));
+
+  connect(_portions, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
+          &shopping, &db::ShoppingList::setPortions);
+  connect(&shopping, &db::ShoppingList::changed,
+          this, &ShoppingListView::refresh);
+  connect(copy, &QPushButton::clicked, this, &ShoppingListView::copy);
+  connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+  refresh();
+}
+
+void ShoppingListView::refresh(void) {
+  auto &book = db::Book::current();
+  _list->clear();
+  for (const auto &p: book.shopping.byGroup()) {
+    auto *group = new QTreeWidgetItem(_list);
+    if (p.first != db::INVALID) {
+      const auto &g = db::at<db::AlimentaryGroupData>(p.first);
+      group->setText(0, g.text);
+      group->setIcon(0, g.decoration());
+    } else
+      group->setText(0, "Autres");
+    QFont f = group->font(0);
+    f.setBold(true);
+    group->setFont(0, f);
+
+    for (const QString &line: book.expansion.format(p.second))
+      new QTreeWidgetItem(group, QStringList(line));
+  }
+  _list->expandAll();
+}
+
+void ShoppingListView::copy(void) {
+  QStringList lines;
+  for (int i=0; i<_list->topLevelItemCount(); i++) {
+    const QTreeWidgetItem *group = _list->topLevelItem(i);
+    lines.append(group->text(0) + ":");
+    for (int j=0; j<group->childCount(); j++)
+      lines.append("- " + group->child(j)->text(0));
+  }
+  QApplication::clipboard()->setText(lines.join("\n"));
+}
+
+} // end of namespace gui
@@ -0,0 +1,24 @@
+#ifndef SHOPPINGLISTVIEW_H
+#define SHOPPINGLISTVIEW_H
+
+#include <QDialog>
+#include <QDoubleSpinBox>
+#include <QTreeWidget>
+
+namespace gui {
+
+class ShoppingListView : public QDialog {
+public:
+  ShoppingListView (QWidget *parent);
+
+private:
+  QDoubleSpinBox *_portions;
+  QTreeWidget *_list;
+
+  void refresh (void);
+  void copy (void);
+};
+
+} // end of namespace gui
+
+#endif // SHOPPINGLISTVIEW_H
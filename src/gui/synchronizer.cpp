@@ -2,15 +2,19 @@
 #include <QPushButton>
 #include <QFormLayout>
 #include <QLabel>
+#include <QLineEdit>
+#include <QSpinBox>
 
 #include <QFileInfo>
 
-#include <QBluetoothServer>
+#include <QTcpServer>
+#include <QTcpSocket>
 
 #include "synchronizer.h"
 #include "../db/book.h"
+#include "../db/sync.h"
 
-#include <iostream>
+#include <QDebug>
 
 namespace gui {
 
@@ -20,11 +24,17 @@ enum TABS {
 };
 
 struct Synchronizer::Data {
-  QLabel *status, *localDate, *remoteDate;
+  QLabel *status, *localDate, *stats;
   QTabWidget *tabs;
 
-  QBluetoothAddress address;
-  QBluetoothServer *server;
+  QLineEdit *host;
+  QSpinBox *clientPort, *serverPort;
+  QPushButton *sync, *listen;
+
+  QTcpServer *server = nullptr;
+  QTcpSocket *socket = nullptr;
+  db::SyncSession *session = nullptr;
+  db::SyncSession::Role role;
 };
 
 struct Synchronizer::Worker : public QObject {
@@ -33,19 +43,111 @@ struct Synchronizer::Worker : public QObject {
 
   Worker(Synchronizer *parent) : parent(*parent), data(*parent->_data) {}
 
+  bool busy (void) const {
+    return data.session != nullptr;
+  }
+
   void panelChanged() {
-    std::cerr << "Panel changed" << std::endl;
     auto i = data.tabs->currentIndex();
-    data.status->setText(i == TABS::CLIENT ? "Client mode" : "Server mode");
+    if (i == TABS::CLIENT && data.server)  stopServer();
+    data.status->setText(i == TABS::CLIENT ? "Client" : "Serveur");
+  }
+
+  void toggleServer (void) {
+    if (data.server)  stopServer();
+    else              startServer();
   }
 
   void startServer() {
-    data.server = new QBluetoothServer(QBluetoothServiceInfo::RfcommProtocol, &parent);
-    connect(data.server, &QBluetoothServer::newConnection, this, &Worker::newConnection);
+    data.server = new QTcpServer(&parent);
+    if (!data.server->listen(QHostAddress::Any, data.serverPort->value())) {
+      data.status->setText("Impossible d'écouter: "
+                           + data.server->errorString());
+      stopServer();
+      return;
+    }
+    connect(data.server, &QTcpServer::newConnection,
+            this, &Worker::newConnection);
+    data.status->setText("En attente sur le port "
+                         + QString::number(data.server->serverPort()));
+    data.listen->setText("Arrêter");
+    data.serverPort->setEnabled(false);
+  }
+
+  void stopServer() {
+    data.server->close();
+    data.server->deleteLater();
+    data.server = nullptr;
+    data.listen->setText("Démarrer");
+    data.serverPort->setEnabled(true);
   }
 
   void newConnection(void) {
-    data.status->setText("New connection");
+    while (QTcpSocket *socket = data.server->nextPendingConnection()) {
+      // One client at a time
+      if (busy()) {
+        socket->disconnectFromHost();
+        socket->deleteLater();
+        continue;
+      }
+      data.status->setText("Connexion de "
+                           + socket->peerAddress().toString());
+      startSession(socket, db::SyncSession::SERVER);
+    }
+  }
+
+  void startClient (void) {
+    if (busy()) return;
+    QTcpSocket *socket = data.socket = new QTcpSocket(this);
+    connect(socket, &QTcpSocket::connected, this, [this, socket] {
+      startSession(socket, db::SyncSession::CLIENT);
+    });
+    connect(socket, &QTcpSocket::errorOccurred, this, [this, socket] {
+      // Reported by the session (or already over)
+      if (busy() || data.socket != socket) return;
+      data.status->setText("Connexion impossible: "
+                           + data.socket->errorString());
+      data.socket->deleteLater();
+      data.socket = nullptr;
+      data.sync->setEnabled(true);
+    });
+
+    data.sync->setEnabled(false);
+    data.status->setText("Connexion à " + data.host->text() + "...");
+    data.socket->connectToHost(data.host->text(), data.clientPort->value());
+  }
+
+  void startSession (QTcpSocket *socket, db::SyncSession::Role role) {
+    socket->setParent(this);  // outlives the server
+    data.socket = socket;
+    data.role = role;
+    data.session =
+      new db::SyncSession(db::Book::current(), role, socket, this);
+    connect(data.session, &db::SyncSession::finished,
+            this, &Worker::sessionFinished);
+    data.session->start();
+  }
+
+  void sessionFinished (bool ok, const QString &message) {
+    const db::SyncSession::Stats &s = data.session->stats();
+    bool client = (data.role == db::SyncSession::CLIENT);
+    data.status->setText(message);
+    data.stats->setText((client ? QString("%1 mis à jour, %2 supprimé(s)")
+                                    .arg(s.updated).arg(s.removed)
+                                : QString("%1 envoyé(s)").arg(s.served))
+                        + QString(" (%1 / %2 ko)")
+                          .arg(s.sent / 1024.0, 0, 'f', 1)
+                          .arg(s.received / 1024.0, 0, 'f', 1));
+
+    if (client && ok && s.updated + s.removed > 0) db::Book::current().save();
+
+    data.session->deleteLater();
+    data.session = nullptr;
+    data.socket->disconnectFromHost();
+    data.socket->deleteLater();
+    data.socket = nullptr;
+    data.sync->setEnabled(true);
+    parent.update();
   }
 };
 
@@ -53,33 +155,48 @@ Synchronizer::Synchronizer(QWidget *parent) : QDialog(parent) {
   _data = new Data();
   _worker = new Worker(this);
 
-  _data->address = QBluetoothAddress();
-
   _data->status = new QLabel();
   _data->localDate = new QLabel();
-  _data->remoteDate = new QLabel();
+  _data->stats = new QLabel();
 
   auto layout = new QVBoxLayout();
 
   auto tabWidget = _data->tabs = new QTabWidget();
   layout->addWidget(tabWidget);
 
-  auto serverWidget = new QWidget();
-  tabWidget->insertTab(TABS::SERVER, serverWidget, "Server");
-
   auto clientWidget = new QWidget();
+  auto clientLayout = new QFormLayout();
+  clientLayout->addRow("Hôte", _data->host = new QLineEdit());
+  clientLayout->addRow("Port", _data->clientPort = new QSpinBox());
+  clientLayout->addRow(_data->sync = new QPushButton("Synchroniser"));
+  clientWidget->setLayout(clientLayout);
   tabWidget->insertTab(TABS::CLIENT, clientWidget, "Client");
 
+  auto serverWidget = new QWidget();
+  auto serverLayout = new QFormLayout();
+  serverLayout->addRow("Port", _data->serverPort = new QSpinBox());
+  serverLayout->addRow(_data->listen = new QPushButton("Démarrer"));
+  serverWidget->setLayout(serverLayout);
+  tabWidget->insertTab(TABS::SERVER, serverWidget, "Serveur");
+
+  for (QSpinBox *sb: {_data->clientPort, _data->serverPort}) {
+    sb->setRange(1024, 65535);
+    sb->setValue(db::SyncSession::DefaultPort);
+  }
+  _data->host->setPlaceholderText("adresse du serveur");
+
   connect(tabWidget, &QTabWidget::currentChanged, _worker, &Worker::panelChanged);
+  connect(_data->sync, &QPushButton::clicked, _worker, &Worker::startClient);
+  connect(_data->listen, &QPushButton::clicked, _worker, &Worker::toggleServer);
 
   auto statusLayout = new QFormLayout();
   layout->addLayout(statusLayout);
 
-  statusLayout->addRow("Status", _data->status);
+  statusLayout->addRow("État", _data->status);
+  statusLayout->addRow("Transfert", _data->stats);
   statusLayout->addRow("Local", _data->localDate);
-  statusLayout->addRow("Remote", _data->remoteDate);
 
-  auto close = new QPushButton("Close");
+  auto close = new QPushButton("Fermer");
   layout->addWidget(close, 0, Qt::AlignRight);
   connect(close, &QPushButton::clicked, this, &QDialog::accept);
 
@@ -92,6 +209,11 @@ Synchronizer::Synchronizer(QWidget *parent) : QDialog(parent) {
   update();
 }
 
+Synchronizer::~Synchronizer(void) {
+  delete _worker;
+  delete _data;
+}
+
 void Synchronizer::update(void) {
   _data->localDate->setText(QFileInfo(db::Book::monitoredPath()).lastModified().toString());
 }
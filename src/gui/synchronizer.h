@@ -8,7 +8,7 @@ namespace gui {
 class Synchronizer : public QDialog {
 public:
   Synchronizer(QWidget *parent);
-  ~Synchronizer (void) = default;
+  ~Synchronizer (void);
 
 private:
   struct Data;
@@ -14,9 +14,6 @@
 #include <QPainter>
 #include <QDir>
 
-#include <QBluetoothDeviceDiscoveryAgent>
-#include <QBluetoothLocalDevice>
-
 #include <QDebug>
 
 #include "updatemanager.h"
@@ -244,7 +241,7 @@ void UpdateManager::doDeploy(void) {
   _output->append("Generated desktop entry " + dfile.fileName());
   _labels.deploy->setState(ProgressLabel::OK, .5);
 
-  if (db::Book::current().close()) {
+  if (confirmedClose(db::Book::current())) {
     qApp->quit();
     QProcess::startDetached(
       "kioclient5", QStringList() << "exec" << dfile.fileName());
@@ -5,6 +5,7 @@
 #include <QLibraryInfo>
 #include <QWindow>
 #include <QSettings>
+#include <QStyle>
 
 #include <QJsonDocument>
 #include <QDebug>
@@ -15,6 +16,7 @@
 
 #include "gui/gui_book.h"
 #include "db/settings.h"
+#include "db/planningmodel.h"
 
 #ifdef Q_OS_ANDROID
 #include <android/log.h>
@@ -171,6 +173,12 @@ int main(int argc, char *argv[]) {
   );
 #endif
 
+  db::PlanningModel::icons = {
+    app.style()->standardIcon(QStyle::SP_FileDialogInfoView),
+    app.style()->standardIcon(QStyle::SP_FileIcon),
+    app.style()->standardIcon(QStyle::SP_DirIcon)
+  };
+
   gui::Book w;
   w.setWindowIcon(QIcon(":/icons/book.png"));
   w.show();
@@ -0,0 +1,98 @@
+"""Helpers driving cookbook-cli on copies of data/cookbook.rbk.
+
+The path to the cookbook-cli binary is the first command-line argument of
+every test script, e.g.
+  python3 tests/http_test.py build-cli/cookbook-cli
+"""
+
+import copy
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+import unittest
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+FIXTURE = os.path.join(ROOT, "data", "cookbook.rbk")
+TIMEOUT = 30
+
+# Messages are French: decode them the same way whatever the locale
+ENV = dict(os.environ, LC_ALL="C.UTF-8")
+
+CLI = None
+
+
+def main():
+    global CLI
+    if len(sys.argv) < 2:
+        sys.exit("usage: %s <cookbook-cli> [unittest options]" % sys.argv[0])
+    CLI = os.path.abspath(sys.argv.pop(1))
+    unittest.main()
+
+
+def fixture():
+    with open(FIXTURE, encoding="utf-8") as f:
+        return json.load(f)
+
+
+class BookTest(unittest.TestCase):
+    """Runs in its own temporary directory"""
+
+    def setUp(self):
+        self.dir = tempfile.mkdtemp(prefix="cookbook-")
+        self.processes = []
+
+    def tearDown(self):
+        for p in self.processes:
+            p.terminate()
+            try:
+                p.wait(TIMEOUT)
+            except subprocess.TimeoutExpired:
+                p.kill()
+                p.wait()
+            p.stderr.close()
+        shutil.rmtree(self.dir)
+
+    def book(self, name, contents=None):
+        """Writes a book (the fixture by default), returns its path"""
+        path = os.path.join(self.dir, name)
+        if contents is None:
+            shutil.copyfile(FIXTURE, path)
+        else:
+            with open(path, "w", encoding="utf-8") as f:
+                json.dump(contents, f, ensure_ascii=False, indent=2)
+        return path
+
+    def run_cli(self, book, *args):
+        return subprocess.run([CLI, "-b", book] + list(args), env=ENV,
+                              stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                              encoding="utf-8", timeout=TIMEOUT)
+
+    def start_cli(self, book, *args):
+        """Starts a server command, returns the port it announces"""
+        p = subprocess.Popen([CLI, "-b", book] + list(args), env=ENV,
+                             stdout=subprocess.DEVNULL, stderr=subprocess.PIPE,
+                             encoding="utf-8")
+        self.processes.append(p)
+        line = p.stderr.readline()
+        m = re.search(r"(?:localhost:|port )(\d+)", line)
+        self.assertIsNotNone(m, "no port announced: %r" % line)
+        return int(m.group(1))
+
+    def dump(self, book):
+        """The book as cookbook-cli saves it"""
+        out = os.path.join(self.dir, "dump.json")
+        r = self.run_cli(book, "convert", out)
+        self.assertEqual(r.returncode, 0, r.stderr)
+        with open(out, encoding="utf-8") as f:
+            return json.load(f)
+
+
+def edited(book, f):
+    """A deep copy of the book modified by f"""
+    b = copy.deepcopy(book)
+    f(b)
+    return b
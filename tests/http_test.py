@@ -0,0 +1,89 @@
+"""cookbook-cli serve over loopback: routes, 404, ETag revalidation and
+deflate."""
+
+import http.client
+import json
+import zlib
+
+import cookbook
+
+
+class HttpTest(cookbook.BookTest):
+
+    def setUp(self):
+        super().setUp()
+        self.recipes = cookbook.fixture()["recipes"]
+        port = self.start_cli(self.book("book.rbk"), "serve", "0")
+        self.http = http.client.HTTPConnection("127.0.0.1", port,
+                                               timeout=cookbook.TIMEOUT)
+
+    def tearDown(self):
+        self.http.close()
+        super().tearDown()
+
+    def get(self, target, **headers):
+        self.http.request("GET", target, headers=headers)
+        r = self.http.getresponse()
+        return r, r.read()
+
+    def test_recipes(self):
+        r, body = self.get("/recipes")
+        self.assertEqual(r.status, 200)
+        self.assertTrue(r.getheader("Content-Type").startswith(
+            "application/json"))
+        summaries = json.loads(body)
+        self.assertEqual(sorted(s["id"] for s in summaries),
+                         sorted(r["id"] for r in self.recipes))
+
+    def test_recipe(self):
+        recipe = self.recipes[0]
+        r, body = self.get("/recipes/%d" % recipe["id"])
+        self.assertEqual(r.status, 200)
+        j = json.loads(body)
+        self.assertEqual(j["id"], recipe["id"])
+        self.assertEqual(j["title"], recipe["title"])
+        self.assertIn("flattened", j)
+
+    def test_unknown_recipe(self):
+        unknown = max(r["id"] for r in self.recipes) + 1
+        for target in ("/recipes/%d" % unknown, "/recipes/abc", "/nowhere"):
+            r, body = self.get(target)
+            self.assertEqual(r.status, 404, target)
+            self.assertIn("error", json.loads(body))
+
+    def test_not_modified(self):
+        r, body = self.get("/recipes")
+        etag = r.getheader("ETag")
+        self.assertTrue(etag)
+
+        r, body = self.get("/recipes", **{"If-None-Match": etag})
+        self.assertEqual(r.status, 304)
+        self.assertEqual(body, b"")
+        self.assertEqual(r.getheader("ETag"), etag)
+
+        r, body = self.get("/recipes", **{"If-None-Match": '"stale"'})
+        self.assertEqual(r.status, 200)
+
+    def test_deflate(self):
+        r, identity = self.get("/recipes")
+        etag = r.getheader("ETag")
+        self.assertIsNone(r.getheader("Content-Encoding"))
+
+        deflate = {"Accept-Encoding": "deflate"}
+        r, body = self.get("/recipes", **deflate)
+        self.assertEqual(r.status, 200)
+        self.assertEqual(r.getheader("Content-Encoding"), "deflate")
+        self.assertEqual(zlib.decompress(body), identity)
+        self.assertLess(len(body), len(identity))
+
+        # Distinct representations, distinct tags
+        etag_z = r.getheader("ETag")
+        self.assertNotEqual(etag_z, etag)
+        r, body = self.get("/recipes", **deflate, **{"If-None-Match": etag})
+        self.assertEqual(r.status, 200)
+        r, body = self.get("/recipes", **deflate, **{"If-None-Match": etag_z})
+        self.assertEqual(r.status, 304)
+
+
+if __name__ == "__main__":
+    cookbook.main()
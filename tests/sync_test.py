@@ -0,0 +1,140 @@
+"""cookbook-cli sync against cookbook-cli sync-server (or a forged server)
+over loopback: the client's book must end up as the server's."""
+
+import filecmp
+import json
+import socket
+import struct
+import threading
+
+import cookbook
+
+
+def cbor(v):
+    """Just what the forged server sends"""
+    def head(major, n):
+        if n < 24:
+            return bytes([major << 5 | n])
+        for info, fmt in ((24, ">B"), (25, ">H"), (26, ">I"), (27, ">Q")):
+            if n < 1 << (8 * struct.calcsize(fmt)):
+                return bytes([major << 5 | info]) + struct.pack(fmt, n)
+
+    if isinstance(v, int):
+        return head(0, v)
+    if isinstance(v, bytes):
+        return head(2, len(v)) + v
+    if isinstance(v, str):
+        b = v.encode("utf-8")
+        return head(3, len(b)) + b
+    if isinstance(v, list):
+        return head(4, len(v)) + b"".join(cbor(x) for x in v)
+    if isinstance(v, dict):
+        return head(5, len(v)) + b"".join(cbor(k) + cbor(x)
+                                          for k, x in v.items())
+    raise TypeError(v)
+
+
+RECIPES = 2
+BUCKETS = 64
+
+
+class SyncTest(cookbook.BookTest):
+
+    def sync(self, server, client):
+        port = self.start_cli(server, "sync-server", "0")
+        return self.run_cli(client, "sync", "127.0.0.1", str(port))
+
+    def assertMirrors(self, server, client):
+        self.assertEqual(self.dump(client), self.dump(server))
+
+    def test_identical(self):
+        server, client = self.book("server.rbk"), self.book("client.rbk")
+        r = self.sync(server, client)
+        self.assertEqual(r.returncode, 0, r.stderr)
+        self.assertIn("Livres identiques", r.stderr)
+        self.assertTrue(r.stdout.startswith("0 mis à jour, 0 supprimé(s)"))
+        self.assertTrue(filecmp.cmp(client, cookbook.FIXTURE, shallow=False))
+
+    def test_edited_recipe(self):
+        def edit(b):
+            b["recipes"][0]["title"] += " (modifiée)"
+        server = self.book("server.rbk")
+        client = self.book("client.rbk", cookbook.edited(cookbook.fixture(),
+                                                         edit))
+        r = self.sync(server, client)
+        self.assertEqual(r.returncode, 0, r.stderr)
+        self.assertIn("Synchronisation terminée", r.stderr)
+        # Only that recipe travels
+        self.assertTrue(r.stdout.startswith("1 mis à jour, 0 supprimé(s)"),
+                        r.stdout)
+        self.assertMirrors(server, client)
+
+    def test_deleted(self):
+        def extra(b):
+            recipe = dict(b["recipes"][0])
+            recipe.update(id=max(r["id"] for r in b["recipes"]) + 1,
+                          title="Supprimée", ing=[], used=0)
+            b["recipes"].append(recipe)
+            b["planning"].append(["2024-05-06", ["Pique-nique"], [], []])
+        server = self.book("server.rbk")
+        client = self.book("client.rbk", cookbook.edited(cookbook.fixture(),
+                                                         extra))
+        r = self.sync(server, client)
+        self.assertEqual(r.returncode, 0, r.stderr)
+        self.assertTrue(r.stdout.startswith("0 mis à jour, 2 supprimé(s)"),
+                        r.stdout)
+        self.assertMirrors(server, client)
+
+    def test_refused(self):
+        """A recipe referring to an unknown ingredient leaves the book as is"""
+        book = cookbook.fixture()
+        recipe = dict(book["recipes"][0])
+        unknown = max(i[0] for i in book["ingredients"]) + 1
+        recipe.update(ing=[[0, [1, book["units"][0][0], unknown, ""]]])
+
+        # In a bucket without local recipes: nothing to remove
+        used = {r["id"] % BUCKETS for r in book["recipes"]}
+        recipe["id"] = next(k for k in range(1, 100 * BUCKETS)
+                            if k > max(r["id"] for r in book["recipes"])
+                            and k % BUCKETS not in used)
+        record = json.dumps(recipe, ensure_ascii=False,
+                            separators=(",", ":")).encode("utf-8")
+
+        replies = [
+            {"t": "buckets", "root": b"forged",
+             "hashes": {RECIPES: [b"forged"] * BUCKETS}},
+            {"t": "leaves", "leaves": {RECIPES: {
+                recipe["id"] % BUCKETS: [[recipe["id"], b"forged"]]}}},
+            {"t": "records", "records": {RECIPES: [record]}},
+        ]
+
+        listener = socket.socket()
+        listener.bind(("127.0.0.1", 0))
+        listener.listen(1)
+
+        def serve():
+            connection, _ = listener.accept()
+            with connection:
+                stream = connection.makefile("rb")
+                for reply in replies:   # after hello, want and get
+                    size, = struct.unpack(">I", stream.read(4))
+                    stream.read(size)
+                    data = cbor(reply)
+                    connection.sendall(struct.pack(">I", len(data)) + data)
+                stream.read()           # until the client leaves
+        server = threading.Thread(target=serve, daemon=True)
+        server.start()
+
+        client = self.book("client.rbk")
+        r = self.run_cli(client, "sync", "127.0.0.1",
+                         str(listener.getsockname()[1]))
+        server.join(cookbook.TIMEOUT)
+        listener.close()
+
+        self.assertEqual(r.returncode, 1)
+        self.assertIn("Enregistrements refusés", r.stderr)
+        self.assertTrue(filecmp.cmp(client, cookbook.FIXTURE, shallow=False))
+
+
+if __name__ == "__main__":
+    cookbook.main()